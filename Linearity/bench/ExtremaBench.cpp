@@ -0,0 +1,68 @@
+// Microbenchmark of the extrema search: the per-sample compare-and-branch loop
+// of GetExtremaTimeStamps / Find_Valid_Signal_Range against the FindMinMax kernels.
+// Usage: ExtremaBench [samples] [repetitions]
+#include "Extrema.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+
+// The loop as it was in linearity.cpp
+static MinMaxIndex BranchLoop(const std::vector<double> &ch_data)
+{
+	MinMaxIndex r;
+	for(size_t index = 0; index < ch_data.size(); index++) {
+		if(ch_data[index] > r.max) {
+			r.max = ch_data[index];
+			r.max_index = index;
+		}
+		if(ch_data[index] < r.min) {
+			r.min = ch_data[index];
+			r.min_index = index;
+		}
+	}
+	return r;
+}
+
+template<typename F>
+static void Time(const std::string &name, const std::vector<double> &ch_data, unsigned repetitions, const MinMaxIndex &reference, F func)
+{
+	MinMaxIndex r;
+	const auto start = std::chrono::steady_clock::now();
+	for(unsigned rep = 0; rep < repetitions; rep++) {
+		r = func();
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	const double samples = double(ch_data.size()) * repetitions;
+	const bool   match   = r.min == reference.min && r.min_index == reference.min_index && r.max == reference.max && r.max_index == reference.max_index;
+	std::cout << std::setw(8) << name << "  "
+	          << std::setw(10) << std::setprecision(4) << elapsed.count()/repetitions*1e3 << " ms  "
+	          << std::setw(10) << std::setprecision(4) << samples/elapsed.count()/1e6 << " MSamples/s  "
+	          << (match ? "ok" : "MISMATCH") << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	const size_t   N_SAMPLES   = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 32u << 20;
+	const unsigned REPETITIONS = (argc > 2) ? std::strtoul (argv[2], nullptr, 10) : 10;
+
+	// Noisy ramp, the typical content of a gate cycle
+	std::vector<double> ch_data(N_SAMPLES);
+	std::mt19937_64 rng(42);
+	std::normal_distribution<double> noise(0, 5e-5);
+	for(size_t index = 0; index < N_SAMPLES; index++) {
+		ch_data[index] = -2.0 + 4.0*index/N_SAMPLES + noise(rng);
+	}
+
+	std::cout << N_SAMPLES << " samples, " << REPETITIONS << " repetitions, best kernel: " << ExtremaKernelName(BestExtremaKernel()) << "\n";
+	const MinMaxIndex reference = BranchLoop(ch_data);
+	Time("loop", ch_data, REPETITIONS, reference, [&]() { return BranchLoop(ch_data); });
+	for(auto kernel : {EXTREMA_KERNEL::SCALAR, EXTREMA_KERNEL::AVX2, EXTREMA_KERNEL::AVX512}) {
+		if(!ExtremaKernelSupported(kernel)) continue;
+		Time(ExtremaKernelName(kernel), ch_data, REPETITIONS, reference, [&]() { return FindMinMax(ch_data.data(), ch_data.size(), kernel); });
+	}
+	return 0;
+}
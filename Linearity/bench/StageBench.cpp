@@ -0,0 +1,132 @@
+// Times the analysis stages of Macro.cpp, linearity.cpp and baseline_script.C
+// on one SampleStream file and reports samples/s and (uncompressed) MB/s.
+// Without a file a synthetic run is generated first.
+// Usage: StageBench [file.root]
+#include "SampleStream.h"
+#include "GateIndex.h"
+#include "RampScanner.h"
+#include "Extrema.h"
+#include "LinearFit.h"
+#include "Residual.h"
+#include "CodeHistogram.h"
+#include "AdcSpec.h"
+#include "StreamGenerator.h"
+#include <ROOT/RNTupleReader.hxx>
+#include <ROOT/RDataFrame.hxx>
+#include <TGraph.h>
+#include <TF1.h>
+#include <TH1D.h>
+#include <TROOT.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+static constexpr double BYTES_GATE = sizeof(gate_vector_t::value_type);
+static constexpr double BYTES_TSTMP= sizeof(tStmp_vector_t::value_type);
+static constexpr double BYTES_DATA = sizeof(data_vector_t::value_type);
+
+template<typename F>
+static void Time(const std::string &name, F func)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const auto [samples, bytes_per_sample] = func();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << std::left  << std::setw(16) << name << std::right
+	          << std::setw(12) << std::setprecision(4) << elapsed.count()*1e3 << " ms"
+	          << std::setw(12) << samples << " samples"
+	          << std::setw(12) << std::setprecision(4) << samples/elapsed.count()/1e6 << " MSamples/s"
+	          << std::setw(12) << std::setprecision(4) << samples*bytes_per_sample/elapsed.count()/(1024*1024) << " MB/s\n";
+}
+
+int main(int argc, char** argv)
+{
+	std::string file_name = (argc > 1) ? argv[1] : "StageBench.root";
+	if(argc < 2) {
+		std::cout << "Generating " << file_name << "\n";
+		WriteSampleStream(GeneratorConfig{}, file_name);
+	}
+
+	auto Reader = ROOT::RNTupleReader::Open("DataTree", file_name);
+	RampScanner scanner;
+	LinearFit   linear_fit;
+	std::vector<double> window_t, window_v;
+
+	// Samples per channel of the file, counted before any stage is timed
+	double total_samples = 0;
+	{
+		SampleStreamView data(Reader.get(), TSTMP);
+		for( auto entry : Reader->GetEntryRange() ) total_samples += data.tStmp(entry).size();
+	}
+
+	Time("gate scan", [&]() {
+		const GateIndex index = GateIndex::Build(Reader.get(), file_name);
+		return std::pair{total_samples, BYTES_GATE + BYTES_TSTMP};
+	});
+
+	Time("extrema", [&]() {
+		SampleStreamView data(Reader.get(), TSTMP | CH0_DATA);
+		ChannelExtrema extrema;
+		for( auto entry : Reader->GetEntryRange() ) {
+			const auto& ch_data = data.ch_data(entry, 0);
+			UpdateExtrema(extrema, ch_data.data(), data.tStmp(entry).data(), ch_data.size());
+		}
+		return std::pair{total_samples, BYTES_TSTMP + BYTES_DATA};
+	});
+
+	Time("ramp scan", [&]() {
+		scanner.Scan(Reader.get());
+		return std::pair{double(scanner.TimeStamps().size()), BYTES_GATE + BYTES_TSTMP + 2*BYTES_DATA};
+	});
+
+	// The fit window of Macro.cpp
+	const auto& extrema = scanner.Extrema(0);
+	const double tmin = std::min(extrema.MinTimeStamp, extrema.MaxTimeStamp) + 20.0;
+	const double tmax = std::max(extrema.MinTimeStamp, extrema.MaxTimeStamp) - 20.0;
+	const auto& tStmp   = scanner.TimeStamps();
+	const auto& ch_data = scanner.Samples(0);
+	auto graph = std::make_unique<TGraph>();
+
+	Time("fill", [&]() {
+		auto hist = CodeHistogram::For<ADC_18BIT>();
+		for(size_t index = 0; index < tStmp.size(); index++) {
+			graph->AddPoint(tStmp[index], ch_data[index]);
+			hist.Fill(ADC_18BIT::ToCode(ch_data[index]));
+			if(tStmp[index] >= tmin && tStmp[index] <= tmax) {
+				window_t.push_back(tStmp[index]);
+				window_v.push_back(ch_data[index]);
+			}
+		}
+		return std::pair{double(tStmp.size()), BYTES_TSTMP + BYTES_DATA};
+	});
+
+	Time("fit (TF1)", [&]() {
+		TF1 fit("bench_fit", "pol1", tmin, tmax);
+		graph->Fit(&fit, "RQN");
+		return std::pair{double(window_t.size()), 2*sizeof(double)};
+	});
+
+	Time("fit (stream)", [&]() {
+		for(size_t index = 0; index < window_t.size(); index++) linear_fit.Add(window_t[index], window_v[index]);
+		return std::pair{double(window_t.size()), 2*sizeof(double)};
+	});
+
+	Time("residual", [&]() {
+		volatile double rms = LinearResidual(window_t.data(), window_v.data(), window_t.size(), linear_fit.Intercept(), linear_fit.Slope()).rms;
+		(void)rms;
+		return std::pair{double(window_t.size()), 2*sizeof(double)};
+	});
+
+	Time("baseline (RDF)", [&]() {
+		ROOT::EnableImplicitMT();
+		ROOT::RDataFrame df("DataTree", file_name);
+		auto h0 = df.Histo1D("SampleStream.ch0_data");
+		auto h1 = df.Histo1D("SampleStream.ch1_data");
+		ROOT::RDF::RunGraphs({h0, h1});
+		ROOT::DisableImplicitMT();
+		return std::pair{2*total_samples, BYTES_DATA};
+	});
+
+	return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef ADC_SPEC_H
+#define ADC_SPEC_H
+
+#include <cstddef>
+
+// Compile-time description of an ADC board: resolution and full-scale
+// reference. Everything the analysis derives from them is a constant, and
+// volts -> code is a single multiplication by the precomputed INVERSE_LSB
+// instead of a division per sample. With Vref = 4.096 V that factor is not a
+// power of two, so the product is rounded like any other.
+template<unsigned BITS, unsigned VREF_MILLIVOLTS>
+struct AdcSpec
+{
+	static_assert(BITS > 1 && BITS < 32, "unsupported ADC resolution");
+
+	static constexpr unsigned ADC_BITS    = BITS;
+	static constexpr double   VOLTAGE_REF = VREF_MILLIVOLTS / 1000.0;  // [V]
+	static constexpr double   VOLTAGE_MAX =  (VOLTAGE_REF / 2);
+	static constexpr double   VOLTAGE_MIN = -(VOLTAGE_REF / 2);
+	static constexpr long     N_CODES     = 1L << BITS;
+	static constexpr double   LSB         = VOLTAGE_REF / N_CODES;     // [V]
+	static constexpr double   INVERSE_LSB = N_CODES / VOLTAGE_REF;     // [1/V]
+
+	// Unit-width bins centred on the codes -2^(BITS-1)..2^(BITS-1)
+	static constexpr size_t   NBINS       = N_CODES + 1;
+	static constexpr double   LOWER_BIN   = -(N_CODES / 2) - 0.5;
+	static constexpr double   UPPER_BIN   =  (N_CODES / 2) + 0.5;
+
+	static constexpr double ToCode (double volts) { return volts * INVERSE_LSB; }
+	static constexpr double ToVolts(double code)  { return code  * LSB; }
+};
+
+// Boards under test
+using ADC_16BIT = AdcSpec<16, 4096>;
+using ADC_18BIT = AdcSpec<18, 4096>;
+using ADC_24BIT = AdcSpec<24, 4096>;
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef BASELINE_ANALYSIS_H
+#define BASELINE_ANALYSIS_H
+
+// The pedestal analysis of baseline_script.C in compiled form, for the batch driver
+
+#include "AdcSpec.h"
+#include "ChannelMap.h"
+#include "ChannelState.h"
+#include "ResultCache.h"
+#include "StageTimer.h"
+#include <string>
+#include <vector>
+
+struct BaselineSettings
+{
+	unsigned adc_bits   = ADC_18BIT::ADC_BITS;  // sets the LSB the histogram bins are aligned to
+	bool     chain_runs = true;                 // one event loop over every run instead of one per run
+};
+
+// Counts and exact moments of every software channel of the runs, in (run, chan) order;
+// run is the index into files. Runs whose channels all hit the cache are not read, the
+// others are histogrammed with RDataFrame on the implicit MT pool, if enabled.
+std::vector<ChannelState> BaselineStates(const std::vector<std::string> &files, const ChannelMap &channel_map, const BaselineSettings &settings,
+                                         const ResultCache &cache, StageReport &report);
+
+// Gaussian fits of the states: <base>.csv and <base>.root as baseline_script.C writes them
+void WriteBaselineSummary(const std::vector<ChannelState> &states, const std::string &base);
+
+#endif
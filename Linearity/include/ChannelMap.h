@@ -0,0 +1,35 @@
+#ifndef CHANNEL_MAP_H
+#define CHANNEL_MAP_H
+
+#include "SampleStream.h"
+#include <vector>
+
+// Which ADC channel every software channel of every run of a sweep is,
+// written out like the adc_chan pairs of baseline_script.C:
+//   ChannelMap({{1,0}, {3,2}})  run 0: ch0 -> ADC 1, ch1 -> ADC 0; run 1: ...
+class ChannelMap
+{
+public:
+	using RunChannels = PerChannel<int>;
+
+	// Throws std::invalid_argument if an ADC channel appears twice
+	explicit ChannelMap(std::vector<RunChannels> adc_chan);
+	// Software channel c of run r is ADC channel N*r + N-1-c (N = N_SOFT_CHAN)
+	static ChannelMap Descending(unsigned runs);
+
+	unsigned Runs() const { return fAdcChan.size(); }
+	size_t   size() const { return fAdcChan.size()*N_SOFT_CHAN; }
+
+	int    AdcChannel(unsigned run, unsigned chan) const { return fAdcChan[run][chan]; }
+	// Position of the ADC channel of (run, chan) among all ADC channels in ascending order,
+	// 0..size()-1, for indexing per-channel arrays and canvas pads
+	size_t Slot(unsigned run, unsigned chan)       const { return fSlot[run][chan]; }
+	int    AdcChannelAt(size_t slot)               const { return fSorted[slot]; }
+
+private:
+	std::vector<RunChannels>        fAdcChan;
+	std::vector<PerChannel<size_t>> fSlot;
+	std::vector<int>                fSorted;
+};
+
+#endif
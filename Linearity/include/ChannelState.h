@@ -0,0 +1,66 @@
+#ifndef CHANNEL_STATE_H
+#define CHANNEL_STATE_H
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CodeHistogram;
+class LinearFit;
+class TH1;
+class TH1D;
+
+enum class STATE_ANALYSIS : std::int32_t
+{
+	LINEARITY = 0,  // Macro, linearity
+	BASELINE  = 1   // baseline_script.C
+};
+
+// Partial result of one ADC channel as a shard of a campaign leaves it:
+// running sums and counts only, so merging the states of several shards
+// (merge_results) gives the state one job over all of their data would have.
+// Kept as plain members so it is written to RNTuple next to the FitRecords.
+struct ChannelState
+{
+	std::int32_t             analysis  = 0;  // STATE_ANALYSIS
+	std::int32_t             adc_chan  = -1; // -1: not known, never merged
+	std::int32_t             soft_chan = 0;
+	std::int32_t             run       = 0;  // lowest index in the run list merged in
+	std::vector<std::string> files;
+	// LinearFit over the fit window
+	std::uint64_t            fit_n      = 0;
+	double                   fit_mean_x = 0, fit_mean_y = 0;
+	double                   fit_cxx    = 0, fit_cyy    = 0, fit_cxy = 0;
+	// Extrema inside the gate
+	double                   min = std::numeric_limits<double>::max(),    min_tstmp = 0;
+	double                   max = std::numeric_limits<double>::lowest(), max_tstmp = 0;
+	// Moments of every sample
+	std::uint64_t            n    = 0;
+	double                   mean = 0;
+	double                   m2   = 0;  // sum of squared deviations from mean
+	// Counts per code of width lsb, from first_code on
+	std::int32_t             adc_bits   = 0;
+	double                   lsb        = 0;
+	std::int64_t             first_code = 0;
+	std::vector<std::uint64_t> counts;
+	std::uint64_t            underflow  = 0;
+	std::uint64_t            overflow   = 0;
+
+	// Throws std::invalid_argument for states of different channels or code widths,
+	// or of an unknown ADC channel
+	void Merge(const ChannelState &other);
+
+	void          SetFit(const LinearFit &fit);
+	LinearFit     Fit() const;
+	// Codes with counts only
+	void          SetCodes(const CodeHistogram &codes, double code_lsb);
+	CodeHistogram Codes() const;
+	// From an LSBHistogramHelper result: one bin per code, exact moments in the statistics
+	void          SetHistogram(const TH1 &hist, double code_lsb);
+	// The same histogram back
+	std::unique_ptr<TH1D> ToTH1(const char* name, const char* title) const;
+};
+
+#endif
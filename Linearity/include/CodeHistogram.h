@@ -0,0 +1,102 @@
+#ifndef CODE_HISTOGRAM_H
+#define CODE_HISTOGRAM_H
+
+#include <cstdint>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+class TH1D;
+class TGraph;
+
+// Differential and integral nonlinearity [LSB] of the codes first..first+dnl.size()-1
+struct CodeLinearity
+{
+	long                first_code  = 0;
+	double              mean_counts = 0; // ideal counts per code the DNL is relative to
+	std::vector<double> dnl;
+	std::vector<double> inl;
+
+	double MaxAbsDNL() const;
+	double MaxAbsINL() const;
+	std::unique_ptr<TGraph> DNLGraph() const;
+	std::unique_ptr<TGraph> INLGraph() const;
+};
+
+// Integer code-density histogram of an ADC with 2^bits codes, one 64-bit
+// counter per code in [-2^(bits-1), 2^(bits-1)] addressed directly by the code.
+// Fill one instance per thread and Merge() them; convert to a TH1 only to draw.
+class CodeHistogram
+{
+public:
+	explicit CodeHistogram(unsigned bits);
+	// Sized for an AdcSpec
+	template<typename ADC>
+	static CodeHistogram For() { return CodeHistogram(ADC::ADC_BITS); }
+
+	unsigned Bits()      const { return fBits; }
+	long     LowerCode() const { return -fOffset; }
+	long     UpperCode() const { return static_cast<long>(fCounts.size()) - 1 - fOffset; }
+
+	// code is a (fractional) LSB value, rounded to the nearest code like the
+	// unit-width bins centred on the codes did. NaN counts as underflow, like -inf.
+	inline void Fill(double code);
+	// Converts volts to codes with a multiplication by 1/LSB
+	void FillVolts(const double* volts, size_t n, double inverse_lsb);
+	// Same with the compile-time 1/LSB of an AdcSpec
+	template<typename ADC>
+	void FillVolts(const double* volts, size_t n)
+	{
+		for(size_t index = 0; index < n; index++) Fill(ADC::ToCode(volts[index]));
+	}
+	void Merge(const CodeHistogram &other);
+	// Adds counts of the codes first_code, first_code+1, ... (e.g. a saved ChannelState);
+	// codes outside of the ADC range go to the under-/overflow
+	void Merge(long first_code, const std::vector<std::uint64_t> &counts, std::uint64_t underflow = 0, std::uint64_t overflow = 0);
+
+	std::uint64_t Counts(long code) const { return fCounts[code + fOffset]; }
+	std::uint64_t Entries()   const;
+	std::uint64_t Underflow() const { return fUnderflow; }
+	std::uint64_t Overflow()  const { return fOverflow; }
+	// Lowest and highest code with counts; Empty() if none
+	bool          Empty()     const;
+	long          MinCode()   const;
+	long          MaxCode()   const;
+
+	// Histogram test of a linear ramp over [first, last]: every code should get
+	// the same share of the counts. Both tests only look at the codes of
+	// [first, last] inside [MinCode(), MaxCode()]; empty if there are none.
+	CodeLinearity RampLinearity(long first, long last) const;
+	// Histogram test of a sine wave over [first, last] (IEEE 1241): transition
+	// levels follow from the cumulative histogram through -cos(pi*CH/N)
+	CodeLinearity SineLinearity(long first, long last) const;
+	// Same over the codes that were hit, without the two partially covered end codes
+	CodeLinearity RampLinearity() const { return RampLinearity(MinCode()+1, MaxCode()-1); }
+	CodeLinearity SineLinearity() const { return SineLinearity(MinCode()+1, MaxCode()-1); }
+
+	std::unique_ptr<TH1D> ToTH1(const char* name, const char* title) const;
+
+private:
+	bool ClampToHits(long &first, long &last) const;
+
+	unsigned                   fBits;
+	long                       fOffset;
+	std::vector<std::uint64_t> fCounts;
+	std::uint64_t              fUnderflow = 0;
+	std::uint64_t              fOverflow  = 0;
+};
+
+inline void CodeHistogram::Fill(double code)
+{
+	const double bin = std::floor(code + 0.5) + fOffset;
+	// Negated so a NaN code (corrupt sample) is counted as underflow, never cast to an index
+	if(!(bin >= 0)) {
+		fUnderflow++;
+	} else if(bin >= fCounts.size()) {
+		fOverflow++;
+	} else {
+		fCounts[static_cast<size_t>(bin)]++;
+	}
+}
+
+#endif
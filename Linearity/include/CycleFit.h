@@ -0,0 +1,41 @@
+#ifndef CYCLE_FIT_H
+#define CYCLE_FIT_H
+
+#include "SampleStream.h"
+#include "Extrema.h"
+#include "RampScanner.h"
+#include <array>
+#include <vector>
+
+// Straight-line fit of one software channel over the ramp of one gate cycle
+struct CycleFit
+{
+	unsigned       run         = 0;
+	size_t         cycle       = 0;
+	unsigned       chan        = 0;
+	double         start_tstmp = 0;  // gate opening
+	ChannelExtrema extrema;
+	size_t         n = 0;            // samples in the fit window
+	double         slope = 0,        slope_error = 0;
+	double         intercept = 0,    intercept_error = 0;
+	double         avg_residual = 0, rms_residual = 0;
+};
+
+// Fits every channel of a scanned cycle between its extrema, offset [tStmp] inside
+std::array<CycleFit, N_SOFT_CHAN> FitScannedCycle(const RampScanner &scanner, double offset);
+
+// Combination of the cycles of one channel
+struct CycleSummary
+{
+	size_t cycles = 0;
+	double mean_slope = 0,     slope_spread = 0;      // unweighted mean and standard deviation
+	double weighted_slope = 0, weighted_slope_error = 0;
+	double mean_intercept = 0, intercept_spread = 0;
+	double weighted_intercept = 0, weighted_intercept_error = 0;
+	double mean_rms_residual = 0;
+	double slope_drift = 0,    slope_drift_error = 0; // d(slope)/d(tStmp) over the run
+};
+
+CycleSummary Summarize(const std::vector<CycleFit> &fits);
+
+#endif
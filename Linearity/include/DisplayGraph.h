@@ -0,0 +1,79 @@
+#ifndef DISPLAY_GRAPH_H
+#define DISPLAY_GRAPH_H
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class TGraph;
+
+// Point budget of the display graphs unless a program is told otherwise
+constexpr size_t DISPLAY_MAX_POINTS = 20000;
+
+// Streaming min/max decimation of a graph for display.
+// Points are binned in x; every bin keeps its lowest and highest point, so
+// glitches and outliers survive while the graph never holds more than
+// max_points points. Whenever the bins run out their width doubles and
+// neighbours are merged, so the x range does not have to be known up front.
+// Points are expected in non-decreasing x (tStmp order); an earlier x is
+// charged to the latest bin. max_points = 0 keeps every point.
+class DisplayGraph
+{
+public:
+	explicit DisplayGraph(size_t max_points = DISPLAY_MAX_POINTS);
+
+	inline void AddPoint(double x, double y);
+	void AddPoints(const double* x, const double* y, size_t n);
+
+	size_t Entries() const { return fEntries; }  // points added
+	size_t size()    const;                      // points kept
+
+	// Replaces the points of graph with the kept ones
+	void Fill(TGraph* graph) const;
+	std::unique_ptr<TGraph> ToTGraph() const;
+
+private:
+	struct Bin
+	{
+		long   key;
+		double x_first;
+		double x_lo, y_lo;
+		double x_hi, y_hi;
+
+		Bin(long k, double x, double y) : key(k), x_first(x), x_lo(x), y_lo(y), x_hi(x), y_hi(y) {}
+		void Add(double x, double y)
+		{
+			if(y < y_lo) { x_lo = x; y_lo = y; }
+			if(y > y_hi) { x_hi = x; y_hi = y; }
+		}
+		void Merge(const Bin &other)
+		{
+			Add(other.x_lo, other.y_lo);
+			Add(other.x_hi, other.y_hi);
+		}
+	};
+
+	void Coarsen();
+
+	size_t           fMaxBins;
+	double           fOrigin  = 0;
+	double           fWidth   = 0;  // 0: every point is its own bin
+	size_t           fEntries = 0;
+	std::vector<Bin> fBins;
+};
+
+inline void DisplayGraph::AddPoint(double x, double y)
+{
+	fEntries++;
+	if(fBins.empty()) fOrigin = x;
+	const long key = (fWidth > 0) ? (long)std::floor((x - fOrigin)/fWidth) : (long)fBins.size();
+	if(fWidth > 0 && key <= fBins.back().key) {
+		fBins.back().Add(x, y);
+		return;
+	}
+	fBins.emplace_back(key, x, y);
+	if(fMaxBins > 0 && fBins.size() > fMaxBins) Coarsen();
+}
+
+#endif
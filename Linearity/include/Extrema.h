@@ -0,0 +1,69 @@
+#ifndef EXTREMA_H
+#define EXTREMA_H
+
+#include <cstddef>
+#include <limits>
+
+enum class EXTREMA_KERNEL
+{
+	AUTO,   // best one the CPU supports
+	SCALAR,
+	AVX2,
+	AVX512
+};
+
+// Extreme values of a span and the index of their first occurrence
+struct MinMaxIndex
+{
+	static constexpr size_t NPOS = std::numeric_limits<size_t>::max();
+	double min = std::numeric_limits<double>::max();    size_t min_index = NPOS;
+	double max = std::numeric_limits<double>::lowest(); size_t max_index = NPOS;
+
+	bool Empty() const { return min_index == NPOS || max_index == NPOS; }
+};
+
+// Extreme values of a channel and the tStmp they were found at
+struct ChannelExtrema
+{
+	double   max = std::numeric_limits<double>::lowest(); unsigned MaxTimeStamp = 0;
+	double   min = std::numeric_limits<double>::max();    unsigned MinTimeStamp = 0;
+};
+
+// Vectorized min/max reduction, dispatched on the CPU at runtime
+MinMaxIndex    FindMinMax(const double* data, size_t n, EXTREMA_KERNEL kernel = EXTREMA_KERNEL::AUTO);
+EXTREMA_KERNEL BestExtremaKernel();
+bool           ExtremaKernelSupported(EXTREMA_KERNEL kernel);
+const char*    ExtremaKernelName(EXTREMA_KERNEL kernel);
+
+// Folds data[0,n) into extrema. Spans have to be passed in time order,
+// ties keep the earliest tStmp.
+template<typename TSTMP>
+void UpdateExtrema(ChannelExtrema &extrema, const double* data, const TSTMP* tStmp, size_t n)
+{
+	const MinMaxIndex r = FindMinMax(data, n);
+	if(r.Empty()) return;
+	if(r.max > extrema.max) {
+		extrema.max          = r.max;
+		extrema.MaxTimeStamp = tStmp[r.max_index];
+	}
+	if(r.min < extrema.min) {
+		extrema.min          = r.min;
+		extrema.MinTimeStamp = tStmp[r.min_index];
+	}
+}
+
+// Same, restricted to the samples with gate1 != 0
+template<typename GATE, typename TSTMP>
+void UpdateExtremaGated(ChannelExtrema &extrema, const double* data, const GATE* gate1, const TSTMP* tStmp, size_t n)
+{
+	size_t index = 0;
+	while(index < n) {
+		while(index < n && gate1[index] == 0) index++;
+		size_t last = index;
+		while(last < n && gate1[last] != 0) last++;
+		if(last > index) UpdateExtrema(extrema, data+index, tStmp+index, last-index);
+		index = last;
+	}
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef GATE_INDEX_H
+#define GATE_INDEX_H
+
+#include <ROOT/RNTupleReader.hxx>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// One gate1 cycle of a run: from the first sample with gate1 != 0 up to the
+// first sample after it with gate1 == 0
+struct GateCycle
+{
+	std::uint64_t start_entry = 0; std::uint32_t start_index = 0; double start_tstmp = 0;
+	std::uint64_t end_entry   = 0; std::uint32_t end_index   = 0; double end_tstmp   = 0;
+	std::uint32_t complete    = 0; // 0 if the run ends before the gate closes
+};
+
+// Gate cycles of one moller_stream_*.root file, kept in a sidecar file next to
+// it (<file>.gidx) so the gate edges are only searched for once per run.
+// The sidecar records size and modification time of the source and is
+// rebuilt when either changes. Cycles are written field by field
+// (44 bytes each, host byte order), independent of the padding of GateCycle.
+class GateIndex
+{
+public:
+	// Scans gate1 and tStmp of every entry
+	static GateIndex Build(ROOT::RNTupleReader* Reader, const std::string &file_name);
+	// Empty if there is no sidecar or it does not match the source anymore
+	static std::optional<GateIndex> Load(const std::string &file_name);
+	// Loads the sidecar, or builds and saves it. Opens the file if no Reader is given.
+	static GateIndex LoadOrBuild(const std::string &file_name, ROOT::RNTupleReader* Reader = nullptr);
+
+	static std::string SidecarName(const std::string &file_name) { return file_name + ".gidx"; }
+
+	// Returns false if the sidecar could not be written (e.g. read-only run storage)
+	bool Save(const std::string &file_name) const;
+
+	size_t                        size()                   const { return fCycles.size(); }
+	const GateCycle&              operator[](size_t cycle) const { return fCycles[cycle]; }
+	const std::vector<GateCycle>& Cycles()                 const { return fCycles; }
+
+private:
+	std::uint64_t          fSourceSize  = 0;
+	std::int64_t           fSourceMTime = 0;
+	std::vector<GateCycle> fCycles;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef LSB_HISTOGRAM_H
+#define LSB_HISTOGRAM_H
+
+// RDataFrame action for the baseline distributions:
+//   df.Book<ROOT::RVecD>(LSBHistogramHelper(name, title, lsb), {"SampleStream.ch0_data"})
+// Every sample is counted in the bin of its ADC code, so the bins are one LSB
+// wide and centred on the codes, and no buffering is needed to find a range.
+// Each slot counts into its own integer array that grows with the codes it
+// sees; the slots are merged into a TH1D at the end. The TH1 statistics are
+// the exact (unbinned) moments of the samples, so GetMean()/GetStdDev() and
+// the initial values of a "gaus" fit come from the data, not from the bins.
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RVec.hxx>
+#include <TH1D.h>
+#include <TROOT.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+class LSBHistogramHelper : public ROOT::Detail::RDF::RActionImpl<LSBHistogramHelper>
+{
+public:
+	using Result_t = TH1D;
+
+	LSBHistogramHelper(std::string name, std::string title, double lsb)
+		: fName(std::move(name)), fTitle(std::move(title)), fLSB(lsb), fInverseLSB(1/lsb),
+		  fSlots(ROOT::IsImplicitMTEnabled() ? ROOT::GetThreadPoolSize() : 1),
+		  fResult(std::make_shared<TH1D>())
+	{
+		fResult->SetDirectory(nullptr);
+	}
+	LSBHistogramHelper(LSBHistogramHelper&&) = default;
+	LSBHistogramHelper(const LSBHistogramHelper&) = delete;
+
+	std::shared_ptr<TH1D> GetResultPtr() const { return fResult; }
+	std::string GetActionName() { return "LSBHistogram"; }
+
+	void Initialize() {}
+	void InitTask(TTreeReader*, unsigned int) {}
+
+	void Exec(unsigned int slot, const ROOT::RVecD &values)
+	{
+		Slot &s = fSlots[slot];
+		if(values.empty()) return;
+		if(s.n == 0) s.shift = values[0];
+		double sum = 0, sum2 = 0;
+		for( auto v : values ) {
+			const long code = (long)std::floor(v*fInverseLSB + 0.5);
+			if(code < s.first_code || code >= s.first_code + (long)s.counts.size()) s.Grow(code);
+			s.counts[code - s.first_code]++;
+			const double d = v - s.shift;
+			sum  += d;
+			sum2 += d*d;
+		}
+		s.n    += values.size();
+		s.sum  += sum;
+		s.sum2 += sum2;
+	}
+
+	void Finalize()
+	{
+		// Common code range and merged moments (Chan et al.) of all slots
+		long lo = std::numeric_limits<long>::max(), hi = std::numeric_limits<long>::lowest();
+		double n = 0, mean = 0, m2 = 0;
+		for( auto const &s : fSlots ) {
+			if(s.n == 0) continue;
+			lo = std::min(lo, s.first_code);
+			hi = std::max(hi, s.first_code + (long)s.counts.size() - 1);
+			const double nb = s.n;
+			const double mean_b = s.shift + s.sum/nb;
+			const double m2_b   = std::max(0.0, s.sum2 - s.sum*s.sum/nb);
+			const double delta  = mean_b - mean;
+			m2   += m2_b + delta*delta*n*nb/(n + nb);
+			mean += delta*nb/(n + nb);
+			n    += nb;
+		}
+		if(n == 0) {
+			fResult->SetNameTitle(fName.c_str(), fTitle.c_str());
+			return;
+		}
+		// Trim codes no slot counted (the slot arrays grow with a margin)
+		std::vector<std::uint64_t> counts(hi - lo + 1, 0);
+		for( auto const &s : fSlots ) {
+			for(size_t i = 0; i < s.counts.size(); i++) counts[s.first_code + i - lo] += s.counts[i];
+		}
+		while(counts.back() == 0) { counts.pop_back(); hi--; }
+		size_t leading = 0;
+		while(counts[leading] == 0) leading++;
+		counts.erase(counts.begin(), counts.begin() + leading);
+		lo += leading;
+
+		fResult->SetNameTitle(fName.c_str(), fTitle.c_str());
+		fResult->SetBins(counts.size(), (lo - 0.5)*fLSB, (hi + 0.5)*fLSB);
+		for(size_t i = 0; i < counts.size(); i++) fResult->SetBinContent(i + 1, counts[i]);
+		// Unbinned moments: sumw, sumw2, sumwx, sumwx2
+		double stats[4] = {n, n, n*mean, m2 + n*mean*mean};
+		fResult->PutStats(stats);
+		fResult->SetEntries(n);
+	}
+
+private:
+	struct Slot
+	{
+		long                       first_code = 0;
+		std::vector<std::uint64_t> counts;
+		std::uint64_t              n     = 0;
+		double                     shift = 0;  // first sample; keeps the sums well conditioned
+		double                     sum   = 0;
+		double                     sum2  = 0;
+
+		// Extend the array to hold code, with some margin on the side it grew
+		void Grow(long code)
+		{
+			if(counts.empty()) {
+				first_code = code - 32;
+				counts.assign(64, 0);
+				return;
+			}
+			const long last_code = first_code + (long)counts.size() - 1;
+			if(code < first_code) {
+				const long extra = std::max<long>(first_code - code, counts.size());
+				counts.insert(counts.begin(), extra, 0);
+				first_code -= extra;
+			}
+			else if(code > last_code) {
+				const long extra = std::max<long>(code - last_code, counts.size());
+				counts.resize(counts.size() + extra, 0);
+			}
+		}
+	};
+
+	std::string           fName;
+	std::string           fTitle;
+	double                fLSB;
+	double                fInverseLSB;
+	std::vector<Slot>     fSlots;
+	std::shared_ptr<TH1D> fResult;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef LINEAR_FIT_H
+#define LINEAR_FIT_H
+
+#include <cstddef>
+
+class TF1;
+
+// Streaming least-squares estimate of y = p0 + p1*x.
+// Gives the estimates and parameter errors of a "pol1" fit to a TGraph without
+// point errors (ROOT scales those by sqrt(chi2/ndf)) in constant memory.
+// Welford-style running means and co-moments keep the sums stable for large
+// tStmp offsets, and partial fits from different threads can be merged.
+class LinearFit
+{
+public:
+	LinearFit() = default;
+	// Resumes from the running sums of a saved fit (ChannelState)
+	LinearFit(size_t n, double mean_x, double mean_y, double cxx, double cyy, double cxy)
+		: fN(n), fMeanX(mean_x), fMeanY(mean_y), fCxx(cxx), fCyy(cyy), fCxy(cxy) {}
+
+	inline void Add(double x, double y);
+	void Merge(const LinearFit &other);
+
+	size_t N()              const { return fN; }
+	double MeanX()          const { return fMeanX; }
+	double MeanY()          const { return fMeanY; }
+	double Cxx()            const { return fCxx; }
+	double Cyy()            const { return fCyy; }
+	double Cxy()            const { return fCxy; }
+	double Slope()          const;
+	double Intercept()      const;
+	double SlopeError()     const;
+	double InterceptError() const;
+	double Chi2()           const; // sum of squared residuals
+	int    NDF()            const { return (fN > 2) ? fN - 2 : 0; }
+
+	// Copies the result into fit, so it can be evaluated and drawn like a fitted TF1
+	void Apply(TF1* fit) const;
+
+private:
+	size_t fN     = 0;
+	double fMeanX = 0;
+	double fMeanY = 0;
+	double fCxx   = 0;
+	double fCyy   = 0;
+	double fCxy   = 0;
+};
+
+inline void LinearFit::Add(double x, double y)
+{
+	fN++;
+	const double dx = x - fMeanX;
+	const double dy = y - fMeanY;
+	fMeanX += dx / fN;
+	fMeanY += dy / fN;
+	fCxx   += dx * (x - fMeanX);
+	fCyy   += dy * (y - fMeanY);
+	fCxy   += dx * (y - fMeanY);
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef LINEARITY_ANALYSIS_H
+#define LINEARITY_ANALYSIS_H
+
+// The ramp analysis of Macro, shared with the batch driver: scan a run,
+// fit every software channel between its extrema, and move the results
+// in and out of the result cache.
+
+#include "RampScanner.h"
+#include "CycleFit.h"
+#include "ChannelMap.h"
+#include "DisplayGraph.h"
+#include "LinearFit.h"
+#include "ResultCache.h"
+#include "StageTimer.h"
+#include <ROOT/TThreadExecutor.hxx>
+#include <ROOT/TSeq.hxx>
+#include <string>
+#include <vector>
+
+class TGraph;
+
+enum SOFTWARE_CHANNEL
+{
+	CHAN_0 = 0,
+	CHAN_1 = 1
+};
+
+struct Signal_tStmp
+{
+	unsigned min;
+	unsigned max;
+};
+
+// Everything the summary graphs need from one ADC channel
+struct ChannelResult
+{
+	int              adc_channel = 0;
+	unsigned         run  = 0;
+	size_t           slot = 0;  // ChannelMap::Slot, index of the per-channel graphs and pads
+	size_t           n = 0;     // samples in the fit window
+	SOFTWARE_CHANNEL chan = CHAN_0;
+	ChannelExtrema   extrema;
+	double           slope = 0,     slope_error = 0;
+	double           intercept = 0, intercept_error = 0;
+	double           avg_residual = 0, rms_residual = 0;
+	LinearFit        fit;       // running sums, for the ChannelState of a shard
+};
+
+struct LinearitySettings
+{
+	double offset     = 20;     // [tStmp] the fit window starts and ends this far inside the extrema
+	bool   use_index  = true;   // use (and create) the gate cycle sidecar index
+	size_t read_ahead = 4;      // entries decoded ahead of the scan, 0: decode in the scan
+	size_t max_points = DISPLAY_MAX_POINTS;
+	bool   all_cycles = false;  // also fit every complete gate cycle after the first one
+};
+
+Signal_tStmp Find_Valid_Signal_Range(const ChannelExtrema &extrema);
+
+// Reads the second gate cycle of a run (the whole run without an index) into a scanner.
+// With cycles, the same pass goes on to the end of the run and appends the fit of every
+// complete cycle after the first one, fit.run is left to the caller. The index this needs
+// is built in memory if settings.use_index is off.
+// Opens its own reader, so runs may be scanned concurrently.
+RampScanner ScanRun(const std::string &file_name, const LinearitySettings &settings, StageReport* report,
+                    std::vector<CycleFit>* cycles = nullptr);
+
+// Fits one channel of an already scanned run and fills its graphs, if given.
+// Only touches objects owned by this channel, so channels may run concurrently.
+// The graphs are decimated to settings.max_points, the fit and residual use every sample.
+ChannelResult AnalyzeChannel(const RampScanner &scanner, SOFTWARE_CHANNEL chan, int adc_channel, const LinearitySettings &settings,
+                             TGraph* gRange, TGraph* gResidual, StageReport* report);
+
+// Runs func(0..n-1) on the pool if there is one, in order otherwise.
+// Results always come back in task order.
+template<typename F>
+auto MapTasks(ROOT::TThreadExecutor* pool, unsigned n, F func) -> std::vector<decltype(func(0u))>
+{
+	if(pool != nullptr) {
+		return pool->Map(func, ROOT::TSeqU(n));
+	}
+	std::vector<decltype(func(0u))> results;
+	for(unsigned i = 0; i < n; i++) {
+		results.push_back( func(i) );
+	}
+	return results;
+}
+
+// One line per cycle fit, with the ADC channel of channel_map
+void WriteCyclesCSV(const std::string &file_name, const std::vector<CycleFit> &fits, const ChannelMap &channel_map);
+
+FitRecord    Record(const ChannelResult &result, const std::string &file);
+ChannelState State (const ChannelResult &result, const std::string &file);
+FitRecord    Record(const CycleFit &fit, const std::string &file, int adc_channel);
+
+// Everything the cached linearity results depend on besides the file and the channel
+std::string LinearityCacheConfig(const LinearitySettings &settings);
+
+// Cache keys of the channels of a run (empty if the file can not be identified) and,
+// if every channel hits and lookup is set, its results and cycle fits.
+// Returns true on a hit.
+bool LookupRun(const ResultCache &cache, const std::string &file, unsigned run, const ChannelMap &channel_map, const std::string &config,
+               bool lookup, PerChannel<std::string> &keys, std::vector<ChannelResult> &results, std::vector<CycleFit> &cycles);
+// Stores result with the cycle fits of its run and channel under key.
+// Returns false if the entry could not be written.
+bool StoreChannel(const ResultCache &cache, const std::string &key, const ChannelResult &result, const std::vector<CycleFit> &cycles,
+                  const std::string &file);
+
+#endif
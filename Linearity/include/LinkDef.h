@@ -1,3 +1,6 @@
 #ifdef __CLING__
 
+#pragma link C++ struct FitRecord+;
+#pragma link C++ struct ChannelState+;
+
 #endif
@@ -0,0 +1,107 @@
+#ifndef RAMP_SCANNER_H
+#define RAMP_SCANNER_H
+
+#include "DataSmpl.h"
+#include "SampleStream.h"
+#include "Extrema.h"
+#include "GateIndex.h"
+#include "ReadAhead.h"
+#include "StageTimer.h"
+#include <ROOT/RNTupleReader.hxx>
+#include <array>
+#include <functional>
+#include <vector>
+#include <limits>
+
+// Forward-only state machine over the SampleStream.
+// Skips the first gate cycle, tracks the extrema of every channel inside the
+// second one and buffers the samples around it, so that a run only has to be
+// decoded once for every channel and every pass.
+class RampScanner
+{
+public:
+	// guard: how far [tStmp] outside of the gate samples are kept
+	explicit RampScanner(double guard = 10);
+
+	// Feed the next entry. Returns false once nothing more is needed.
+	bool Process(const EntrySpans &entry);
+	bool Process(const gate_vector_t &gate1, const tStmp_vector_t &tStmp, const ChannelSet &ch_data);
+	bool Process(const tDataSamples &entry);
+
+	// Advances the gate state of an entry that ends before the first cycle does.
+	// Returns false, leaving the state untouched, if the entry has to be Process()ed.
+	bool Skip(const gate_vector_t &gate1);
+
+	// Buffers samples not younger than oldest without touching the gate state,
+	// for skipped entries that turn out to fall into the guard window
+	void Backfill(const EntrySpans &entry, double oldest);
+
+	// Start over before the first cycle, keeping the capacity of the buffers,
+	// so one scanner can walk cycle after cycle without reallocating
+	void Reset();
+	// After Done(): start over at the first gate opening after the cycle just scanned,
+	// for following a stream cycle after cycle. The entry that finished the cycle has
+	// to be Process()ed again, the next cycle may start in it.
+	void NextCycle();
+	// Room for samples in the buffers of the time stamps and of every channel
+	void Reserve(size_t samples);
+
+	// Walk Reader from the first entry until Done().
+	// Channel columns are only decoded once the first cycle is over.
+	void Scan(ROOT::RNTupleReader* Reader);
+	// Jump straight to cycle of index and treat it as the second cycle
+	void Scan(ROOT::RNTupleReader* Reader, const GateIndex &index, size_t cycle);
+	// Same, over entries decoded ahead by stream. stream has to cover CycleRange()
+	// with every column; it is stopped once Done().
+	void Scan(ReadAhead &stream, const GateIndex &index, size_t cycle);
+	// Same, but follows stream to its end: on_cycle sees the scanner of every cycle
+	// from cycle of index on once its range is found, then NextCycle() moves on.
+	// Read() counts the whole stream afterwards.
+	void ScanCycles(ReadAhead &stream, const GateIndex &index, size_t cycle, const std::function<void(const RampScanner&)> &on_cycle);
+	// Entries Scan(Reader, index, cycle) walks
+	ROOT::RNTupleGlobalRange CycleRange(ROOT::RNTupleReader* Reader, const GateIndex &index, size_t cycle) const;
+
+	bool Done()       const { return fState == STATE::DONE; }
+	bool RangeFound() const { return fState == STATE::TRAILING || fState == STATE::DONE; }
+	// tStmp of the first gated sample of the cycle scanned, once it opened
+	double GateOpenTimeStamp() const { return fGateOpenTimeStamp; }
+
+	const ChannelExtrema&      Extrema(unsigned chan)    const { return fExtrema[chan]; }
+	const std::vector<double>& TimeStamps()              const { return fTimeStamps; }
+	const std::vector<double>& Samples(unsigned chan)    const { return fSamples[chan]; }
+	// Entries, samples and column bytes decoded by Scan()
+	const StageCounters&       Read()                    const { return fRead; }
+
+private:
+	enum class STATE
+	{
+		SEEK_FIRST_CYCLE,
+		IN_FIRST_CYCLE,
+		SEEK_SECOND_CYCLE,
+		IN_SECOND_CYCLE,
+		TRAILING,
+		DONE
+	};
+
+	void Trim(double oldest);
+	// Enter the second cycle state right before cycle of index
+	void StartAt(const GateIndex &index, size_t cycle);
+	// Reserves the samples of cycle plus the guard windows, from the length and
+	// sample spacing of the first entry of the scan
+	void ReserveCycle(const GateCycle &cycle, const EntrySpans &first);
+	// Charges n samples with their tStmp and channel columns to fRead
+	void CountSamples(size_t n);
+
+	double                          fGuard;
+	bool                            fSkipped = false;
+	STATE                           fState = STATE::SEEK_FIRST_CYCLE;
+	double                          fLastGatedTimeStamp = 0;
+	double                          fGateOpenTimeStamp  = 0;
+	double                          fNotBefore = std::numeric_limits<double>::lowest();
+	PerChannel<ChannelExtrema>      fExtrema;
+	std::vector<double>             fTimeStamps;
+	PerChannel<std::vector<double>> fSamples;
+	StageCounters                   fRead;
+};
+
+#endif
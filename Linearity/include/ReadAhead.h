@@ -0,0 +1,84 @@
+#ifndef READ_AHEAD_H
+#define READ_AHEAD_H
+
+#include "SampleStream.h"
+#include <ROOT/RNTupleReader.hxx>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The projected columns of one decoded entry. The vectors are reused from
+// entry to entry and only grow, so a stream stops allocating once warm.
+struct EntryBuffer
+{
+	ROOT::NTupleSize_t        entry = 0;
+	gate_vector_t             gate1;
+	tStmp_vector_t            tStmp;
+	PerChannel<data_vector_t> ch_data;
+	EntrySpans                spans;  // into the vectors above, empty for columns not read
+};
+
+// Decodes a range of SampleStream entries on a producer thread, ahead of the
+// analysis, into a ring of depth reusable buffers. The producer blocks while
+// every buffer is queued or in use (back-pressure), so at most depth entries
+// are held. It opens its own reader; with implicit MT on, RNTuple also
+// decompresses the pages of a cluster in parallel.
+// Starting a producer turns on ROOT::EnableThreadSafety(), so callers need not.
+// depth 0 decodes on the calling thread inside Next(), without a producer.
+//   ReadAhead stream(file, TSTMP | CH0_DATA, SeekTimeRange(Reader, tmin, tmax));
+//   while(const EntryBuffer* buffer = stream.Next()) ...
+class ReadAhead
+{
+public:
+	ReadAhead(const std::string &file_name, unsigned columns, ROOT::RNTupleGlobalRange range, size_t depth = 4);
+	~ReadAhead();
+	ReadAhead(const ReadAhead&) = delete;
+	ReadAhead& operator=(const ReadAhead&) = delete;
+
+	size_t             Depth()   const { return fDepth; }
+	ROOT::NTupleSize_t First()   const { return fFirst; }
+	// Entries of the range, to size output buffers up front
+	ROOT::NTupleSize_t Entries() const { return fEnd - fFirst; }
+
+	// Next entry in order, or nullptr at the end of the range. Hands the previous
+	// buffer back to the producer. Rethrows what the producer threw.
+	const EntryBuffer* Next();
+	// Stop decoding early, e.g. once the analysis has what it needs
+	void Stop();
+	// Stops and waits for the producer. [s] of CPU it spent opening and decoding,
+	// for the stage timer of the caller (0 with depth 0: that is the caller's own).
+	double ProducerCPU();
+
+private:
+	void Open();
+	void Decode(ROOT::NTupleSize_t entry, EntryBuffer &buffer);
+	void Produce();
+
+	std::string                           fFileName;
+	unsigned                              fColumns;
+	size_t                                fDepth;
+	ROOT::NTupleSize_t                    fFirst;
+	ROOT::NTupleSize_t                    fNext;
+	ROOT::NTupleSize_t                    fEnd;
+	std::unique_ptr<ROOT::RNTupleReader>  fReader;  // owned by the producer (or the caller with depth 0)
+	std::unique_ptr<SampleStreamView>     fData;
+	std::vector<EntryBuffer>              fBuffers;
+	std::deque<size_t>                    fFree;    // buffers the producer may fill
+	std::deque<size_t>                    fFilled;  // decoded, in entry order
+	size_t                                fCurrent;  // held by the consumer
+	bool                                  fProducerDone = false;
+	bool                                  fStop = false;
+	std::exception_ptr                    fError;
+	double                                fProducerCPU = 0;
+	std::mutex                            fMutex;
+	std::condition_variable               fFreeCV;
+	std::condition_variable               fFilledCV;
+	std::thread                           fProducer;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef RESIDUAL_H
+#define RESIDUAL_H
+
+#include <cstddef>
+#include <limits>
+
+class TH1;
+class DisplayGraph;
+
+// Summary of the residuals (fit - data) of a straight line fit
+struct ResidualStats
+{
+	size_t n    = 0;
+	double mean = 0;
+	double rms  = 0;  // spread about the mean, as GetRMS() in Macro.cpp
+	double min  = std::numeric_limits<double>::max();
+	double max  = std::numeric_limits<double>::lowest();
+};
+
+// Evaluates p0 + p1*x[i] - y[i] in blocks and accumulates mean/RMS in the same pass.
+// hist and graph are filled from the block buffer when given, so the residuals
+// are never stored unless they are plotted.
+ResidualStats LinearResidual(const double* x, const double* y, size_t n, double p0, double p1, TH1* hist = nullptr, DisplayGraph* graph = nullptr);
+
+#endif
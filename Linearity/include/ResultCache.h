@@ -0,0 +1,58 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "ResultsWriter.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Identity of a source run. The anchor of the RNTuple points at its header
+// and footer, so it changes whenever the data are rewritten, even if size and
+// modification time happen to survive a copy.
+struct SourceIdentity
+{
+	std::uint64_t size        = 0;
+	std::int64_t  mtime       = 0;
+	std::uint64_t anchor_hash = 0;
+
+	// All zero if the file or the RNTuple can not be read
+	static SourceIdentity Of(const std::string &file_name, const char* ntuple_name = "DataTree");
+};
+
+// What an earlier job left for one channel of one run
+struct CachedChannel
+{
+	std::vector<FitRecord>    records;  // the per-run fit and, if configured, the per-cycle fits
+	std::vector<ChannelState> states;
+};
+
+// Per-channel results of earlier jobs, one small results file per key in
+// <directory>/<key>.root. The key hashes the source identity, the channel and
+// a string with every setting the analysis depends on, so a new or rewritten
+// run, or a changed parameter (e.g. OFFSET), misses and is computed again.
+// An empty directory disables the cache.
+class ResultCache
+{
+public:
+	explicit ResultCache(std::string directory);
+
+	bool Enabled() const { return !fDirectory.empty(); }
+
+	// Empty, i.e. do not cache, for a source that could not be identified
+	std::string Key(const SourceIdentity &source, int soft_chan, int adc_chan, const std::string &config) const;
+	std::optional<CachedChannel> Load(const std::string &key) const;
+	// Returns false if the entry could not be written (it is then simply missed next time)
+	bool Store(const std::string &key, const CachedChannel &channel) const;
+
+	// Counters of this instance, for the job summary
+	unsigned Hits()   const { return fHits; }
+	unsigned Misses() const { return fMisses; }
+
+private:
+	std::string      fDirectory;
+	mutable unsigned fHits   = 0;
+	mutable unsigned fMisses = 0;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef RESULTS_WRITER_H
+#define RESULTS_WRITER_H
+
+#include "ChannelState.h"
+#include <ROOT/RNTupleWriter.hxx>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+class TFile;
+
+// One straight-line fit of one software channel: of a run (cycle = -1)
+// or of one gate cycle. Fields that a program does not compute stay NaN.
+struct FitRecord
+{
+	std::string   file;
+	std::int32_t  run          = 0;   // index of the file in the program's run list
+	std::int64_t  cycle        = -1;  // gate cycle, -1 for the per-run fit
+	std::int32_t  soft_chan    = 0;
+	std::int32_t  adc_chan     = 0;
+	double        start_tstmp  = std::numeric_limits<double>::quiet_NaN();
+	std::uint64_t n            = 0;   // samples in the fit window
+	double        slope        = 0, slope_error     = 0;
+	double        intercept    = 0, intercept_error = 0;
+	double        avg_residual = 0, rms_residual    = 0;
+	double        min          = 0, min_tstmp = 0;
+	double        max          = 0, max_tstmp = 0;
+	// Code density test
+	std::int32_t  adc_bits     = 0;
+	double        max_abs_dnl  = std::numeric_limits<double>::quiet_NaN();
+	double        max_abs_inl  = std::numeric_limits<double>::quiet_NaN();
+};
+
+// Writes FitRecords as the field "Fit" of a small RNTuple, so trend studies
+// read a few columns instead of canvases; plot_results draws them on demand.
+// The ChannelStates of a shard go into a second RNTuple of the same file,
+// for merge_results.
+class ResultsWriter
+{
+public:
+	static constexpr const char* NTUPLE_NAME       = "LinearityResults";
+	static constexpr const char* FIELD_NAME        = "Fit";
+	static constexpr const char* STATE_NTUPLE_NAME = "ChannelStates";
+	static constexpr const char* STATE_FIELD_NAME  = "State";
+
+	explicit ResultsWriter(const std::string &file_name);
+	~ResultsWriter();
+
+	void Fill(const FitRecord &record);
+	void Fill(const ChannelState &state);
+
+private:
+	std::unique_ptr<TFile>               fFile;  // outlives the writers, which commit on destruction
+	std::shared_ptr<FitRecord>           fRecord;
+	std::unique_ptr<ROOT::RNTupleWriter> fWriter;
+	std::shared_ptr<ChannelState>        fState;
+	std::unique_ptr<ROOT::RNTupleWriter> fStateWriter;
+};
+
+std::vector<FitRecord>    ReadFitRecords(const std::string &file_name);
+// Empty for files written before the states were
+std::vector<ChannelState> ReadChannelStates(const std::string &file_name);
+
+#endif
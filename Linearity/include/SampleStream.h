@@ -0,0 +1,136 @@
+#ifndef SAMPLE_STREAM_H
+#define SAMPLE_STREAM_H
+
+#include "DataSmpl.h"
+#include <ROOT/RNTupleReader.hxx>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <limits>
+#include <string>
+#include <vector>
+
+constexpr unsigned N_SOFT_CHAN = 2;
+
+using gate_vector_t = decltype(tDataSamples::gate1);
+using tStmp_vector_t= decltype(tDataSamples::tStmp);
+using data_vector_t = decltype(tDataSamples::ch0_data);
+
+// The software channels of a tDataSamples entry, indexed by channel.
+// A board with more channels per stream only extends these two tables,
+// N_SOFT_CHAN and the channel bits of SAMPLE_COLUMN.
+constexpr const char* CHANNEL_MEMBER_NAMES[N_SOFT_CHAN] = {"ch0_data", "ch1_data"};
+constexpr data_vector_t tDataSamples::* CHANNEL_MEMBERS[N_SOFT_CHAN] = {&tDataSamples::ch0_data, &tDataSamples::ch1_data};
+
+// Per-channel storage, one element per software channel next to each other
+template<typename T>
+using PerChannel = std::array<T, N_SOFT_CHAN>;
+// The channel columns of one entry (structure of arrays); nullptr for channels not read
+using ChannelSet = PerChannel<const data_vector_t*>;
+
+inline ChannelSet Channels(const tDataSamples &entry)
+{
+	ChannelSet channels;
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) channels[chan] = &(entry.*CHANNEL_MEMBERS[chan]);
+	return channels;
+}
+
+// Read-only view of contiguous samples, e.g. one column of an entry (std::span is C++20).
+// Does not own the samples: valid as long as the buffer it was made from is not refilled.
+template<typename T>
+class SampleSpan
+{
+public:
+	SampleSpan() = default;
+	SampleSpan(const T* data, size_t size) : fData(data), fSize(size) {}
+	template<typename Alloc>
+	SampleSpan(const std::vector<T, Alloc> &samples) : fData(samples.data()), fSize(samples.size()) {}
+
+	const T* data()  const { return fData; }
+	size_t   size()  const { return fSize; }
+	bool     empty() const { return fSize == 0; }
+	const T* begin() const { return fData; }
+	const T* end()   const { return fData + fSize; }
+	const T& operator[](size_t index) const { return fData[index]; }
+	const T& front() const { return fData[0]; }
+	const T& back()  const { return fData[fSize-1]; }
+	SampleSpan subspan(size_t offset, size_t count) const { return SampleSpan(fData + offset, count); }
+
+private:
+	const T* fData = nullptr;
+	size_t   fSize = 0;
+};
+
+using gate_span_t  = SampleSpan<gate_vector_t::value_type>;
+using tStmp_span_t = SampleSpan<tStmp_vector_t::value_type>;
+using data_span_t  = SampleSpan<data_vector_t::value_type>;
+
+// The columns of one entry without copying them; empty for columns not read
+struct EntrySpans
+{
+	gate_span_t             gate1;
+	tStmp_span_t            tStmp;
+	PerChannel<data_span_t> ch_data;
+};
+
+inline EntrySpans Spans(const tDataSamples &entry)
+{
+	EntrySpans spans;
+	spans.gate1 = entry.gate1;
+	spans.tStmp = entry.tStmp;
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) spans.ch_data[chan] = entry.*CHANNEL_MEMBERS[chan];
+	return spans;
+}
+
+// Members of tDataSamples, to be OR'ed together
+enum SAMPLE_COLUMN : unsigned
+{
+	GATE1    = 1u << 0,
+	TSTMP    = 1u << 1,
+	CH0_DATA = 1u << 2,
+	CH1_DATA = 1u << 3,
+	ALL_CHANNELS = CH0_DATA | CH1_DATA,
+	ALL_COLUMNS  = GATE1 | TSTMP | ALL_CHANNELS
+};
+
+// The channel bits follow each other from CH0_DATA on
+inline SAMPLE_COLUMN ChannelColumn(unsigned chan)
+{
+	return static_cast<SAMPLE_COLUMN>(CH0_DATA << chan);
+}
+
+// Projection of the SampleStream field onto the members a pass actually uses.
+// Every member gets its own subfield view (e.g. "SampleStream.gate1"),
+// so columns that were not requested are never decompressed.
+class SampleStreamView
+{
+public:
+	SampleStreamView(ROOT::RNTupleReader* Reader, unsigned columns);
+
+	bool Has(SAMPLE_COLUMN column) const { return (fColumns & column) != 0; }
+
+	const gate_vector_t&  gate1  (ROOT::NTupleSize_t entry);
+	const tStmp_vector_t& tStmp  (ROOT::NTupleSize_t entry);
+	const data_vector_t&  ch_data(ROOT::NTupleSize_t entry, unsigned chan);
+	// Every projected channel of entry
+	ChannelSet            channels(ROOT::NTupleSize_t entry);
+	// Every projected column of entry, into the storage of the views.
+	// Valid until the views read another entry.
+	EntrySpans            spans(ROOT::NTupleSize_t entry);
+	// Every projected column of entry, decoded straight into the vectors given
+	// (no copy out of the views). The views keep reading into them afterwards.
+	EntrySpans            ReadInto(ROOT::NTupleSize_t entry, gate_vector_t &gate1, tStmp_vector_t &tStmp, PerChannel<data_vector_t> &ch_data);
+
+private:
+	unsigned                                     fColumns;
+	std::optional<ROOT::RNTupleView<gate_vector_t>>  fGate1;
+	std::optional<ROOT::RNTupleView<tStmp_vector_t>> fTimeStamp;
+	PerChannel<std::optional<ROOT::RNTupleView<data_vector_t>>> fChannel;
+};
+
+// Entries whose samples can overlap [tmin, tmax]. tStmp increases
+// monotonically, so this binary-searches the first and last tStmp of the
+// entries and only ever decodes the tStmp column of the probed ones.
+ROOT::RNTupleGlobalRange SeekTimeRange(ROOT::RNTupleReader* Reader, double tmin, double tmax = std::numeric_limits<double>::max());
+
+#endif
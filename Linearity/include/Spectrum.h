@@ -0,0 +1,79 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class TH1D;
+class TVirtualFFT;
+
+enum class SPECTRUM_WINDOW
+{
+	HANN,
+	BLACKMAN_HARRIS  // 4-term, sidelobes below -92 dB, for the spurs of 18/24 bit boards
+};
+
+// Dynamic performance of a sine wave run, from the averaged spectrum (IEEE 1241)
+struct SpectrumMetrics
+{
+	double frequency     = 0;  // fundamental [Hz]
+	double signal        = 0;  // power [V^2]
+	double noise         = 0;  // power without DC, fundamental and harmonics, extrapolated over their bins [V^2]
+	double distortion    = 0;  // power of the harmonics [V^2]
+	double noise_density = 0;  // [V/sqrt(Hz)]
+	double snr           = 0;  // [dB]
+	double sinad         = 0;  // [dB]
+	double thd           = 0;  // [dBc]
+	double sfdr          = 0;  // [dBc]
+	double enob          = 0;  // [bits]
+};
+
+// Welch averaged power spectrum of a sample stream.
+// Samples are cut into overlapping segments of segment_length, windowed and
+// transformed as they come in; only the running sum of |X|^2 is kept, so the
+// memory is bounded by the segment length and not by the run length.
+// Fill one instance per task (e.g. per range of entries) and Merge() them.
+class WelchSpectrum
+{
+public:
+	// overlap: fraction of a segment shared with the next one
+	explicit WelchSpectrum(size_t segment_length = 1 << 16, double overlap = 0.5, SPECTRUM_WINDOW window = SPECTRUM_WINDOW::BLACKMAN_HARRIS);
+	~WelchSpectrum();
+	WelchSpectrum(WelchSpectrum&&);
+	WelchSpectrum& operator=(WelchSpectrum&&);
+
+	// Samples have to follow each other without gaps
+	void Add(const double* samples, size_t n);
+	// Requires the same segment length and window
+	void Merge(const WelchSpectrum &other);
+
+	size_t        SegmentLength() const { return fLength; }
+	std::uint64_t Segments()      const { return fSegments; }
+	// Bins on either side of a tone that hold its window main lobe
+	unsigned      LobeBins()      const;
+
+	// One-sided power spectral density [V^2/Hz] of the bins 0..N/2
+	std::vector<double> PSD(double sample_rate) const;
+	SpectrumMetrics     Analyze(double sample_rate, unsigned harmonics = 5) const;
+	// Amplitude spectral density [V/sqrt(Hz)] over [0, sample_rate/2]
+	std::unique_ptr<TH1D> ToTH1(const char* name, const char* title, double sample_rate) const;
+
+private:
+	void Transform();
+
+	size_t                       fLength;
+	size_t                       fHop;
+	SPECTRUM_WINDOW              fWindowType;
+	std::vector<double>          fWindow;
+	double                       fWindowPower = 0;  // sum of w^2
+	std::vector<double>          fSegment;          // samples of the segment being filled
+	size_t                       fFilled = 0;
+	std::vector<double>          fWindowed;
+	std::vector<double>          fPower;            // sum of |X_k|^2 over the segments
+	std::uint64_t                fSegments = 0;
+	std::unique_ptr<TVirtualFFT> fFFT;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+// Header only so ROOT macros (baseline_script.C) can include it as well
+
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Which CPU clock a stage is charged with.
+// THREAD for stages run on the calling thread (and the worker tasks of Macro),
+// PROCESS for stages that fan out internally, e.g. RDataFrame with implicit MT.
+// Work a stage hands to a helper thread of its own (ReadAhead) is added with Timer::CPU().
+enum class CPU_CLOCK
+{
+	THREAD,
+	PROCESS
+};
+
+struct StageCounters
+{
+	uint64_t entries = 0;  // RNTuple entries read
+	uint64_t samples = 0;  // samples processed
+	uint64_t bytes   = 0;  // uncompressed column bytes decoded
+	uint64_t points  = 0;  // points added to graphs
+
+	StageCounters& operator+=(const StageCounters &other)
+	{
+		entries += other.entries;
+		samples += other.samples;
+		bytes   += other.bytes;
+		points  += other.points;
+		return *this;
+	}
+};
+
+struct StageStats
+{
+	std::string   stage;
+	int           channel = -1;  // -1: not tied to a channel
+	uint64_t      calls   = 0;
+	double        wall    = 0;   // [s]
+	double        cpu     = 0;   // [s]
+	StageCounters counters;
+
+	double SamplesPerSecond() const { return (wall > 0) ? counters.samples/wall : 0; }
+	double MBPerSecond()      const { return (wall > 0) ? counters.bytes/wall/(1024.0*1024.0) : 0; }
+	// Well below 1: the stage waits on I/O (or on other threads)
+	double CPUFraction()      const { return (wall > 0) ? cpu/wall : 0; }
+};
+
+// Collects per-stage (and per-channel) wall clock, CPU time and counters.
+// Recording is thread safe; stages keep the order they were first seen in.
+class StageReport
+{
+public:
+	explicit StageReport(std::string program) : fProgram(std::move(program)) {}
+
+	// Scoped timer. Charges its stage when it goes out of scope (or on Stop()).
+	class Timer
+	{
+	public:
+		Timer(StageReport* report, std::string stage, int channel, CPU_CLOCK clock)
+			: fReport(report), fStage(std::move(stage)), fChannel(channel), fClock(clock),
+			  fWallStart(std::chrono::steady_clock::now()), fCPUStart(CPUTime(clock)) {}
+		Timer(const Timer&) = delete;
+		Timer& operator=(const Timer&) = delete;
+		Timer(Timer &&other) noexcept
+			: fReport(std::exchange(other.fReport, nullptr)), fStage(std::move(other.fStage)), fChannel(other.fChannel),
+			  fClock(other.fClock), fWallStart(other.fWallStart), fCPUStart(other.fCPUStart), fCPUOther(other.fCPUOther), fCounters(other.fCounters) {}
+		~Timer() { Stop(); }
+
+		Timer& Entries(uint64_t n) { fCounters.entries += n; return *this; }
+		Timer& Samples(uint64_t n) { fCounters.samples += n; return *this; }
+		Timer& Bytes  (uint64_t n) { fCounters.bytes   += n; return *this; }
+		Timer& Points (uint64_t n) { fCounters.points  += n; return *this; }
+		// [s] spent for this stage on another thread, which the clock does not see
+		Timer& CPU    (double s)   { fCPUOther        += s; return *this; }
+
+		void Stop()
+		{
+			if(fReport == nullptr) return;
+			const std::chrono::duration<double> wall = std::chrono::steady_clock::now() - fWallStart;
+			fReport->Record(fStage, fChannel, wall.count(), CPUTime(fClock) - fCPUStart + fCPUOther, fCounters);
+			fReport = nullptr;
+		}
+
+	private:
+		StageReport*                          fReport;
+		std::string                           fStage;
+		int                                   fChannel;
+		CPU_CLOCK                             fClock;
+		std::chrono::steady_clock::time_point fWallStart;
+		double                                fCPUStart;
+		double                                fCPUOther = 0;
+		StageCounters                         fCounters;
+	};
+
+	Timer Stage(std::string stage, int channel = -1, CPU_CLOCK clock = CPU_CLOCK::THREAD)
+	{
+		return Timer(this, std::move(stage), channel, clock);
+	}
+
+	void Record(const std::string &stage, int channel, double wall, double cpu, const StageCounters &counters)
+	{
+		std::lock_guard<std::mutex> lock(fMutex);
+		const auto key = std::make_pair(stage, channel);
+		auto found = fIndex.find(key);
+		if(found == fIndex.end()) {
+			found = fIndex.emplace(key, fStats.size()).first;
+			fStats.emplace_back();
+			fStats.back().stage   = stage;
+			fStats.back().channel = channel;
+		}
+		StageStats &stats = fStats[found->second];
+		stats.calls++;
+		stats.wall     += wall;
+		stats.cpu      += cpu;
+		stats.counters += counters;
+	}
+
+	std::vector<StageStats> Stats() const
+	{
+		std::lock_guard<std::mutex> lock(fMutex);
+		return fStats;
+	}
+
+	void Print(std::ostream &out = std::cout) const
+	{
+		const auto precision = out.precision();
+		out << "Stage timing for " << fProgram << "\n";
+		out << std::left << std::setw(20) << "stage" << std::right << std::setw(6) << "chan"
+		    << std::setw(12) << "wall [s]" << std::setw(12) << "cpu [s]" << std::setw(8) << "cpu/w"
+		    << std::setw(14) << "samples/s" << std::setw(10) << "MB/s" << "\n";
+		for( auto const &stats : Stats() ) {
+			out << std::left << std::setw(20) << stats.stage << std::right << std::setw(6) << stats.channel
+			    << std::setw(12) << std::setprecision(4) << stats.wall
+			    << std::setw(12) << std::setprecision(4) << stats.cpu
+			    << std::setw(8)  << std::setprecision(3) << stats.CPUFraction()
+			    << std::setw(14) << std::setprecision(4) << stats.SamplesPerSecond()
+			    << std::setw(10) << std::setprecision(4) << stats.MBPerSecond() << "\n";
+		}
+		out.precision(precision);
+	}
+
+	void WriteJSON(std::ostream &out) const
+	{
+		out << "{\n  \"program\": \"" << fProgram << "\",\n  \"stages\": [";
+		const auto stats = Stats();
+		for(size_t i = 0; i < stats.size(); i++) {
+			const StageStats &s = stats[i];
+			out << (i ? ",\n" : "\n") << std::setprecision(9)
+			    << "    {\"stage\": \"" << s.stage << "\", \"channel\": " << s.channel << ", \"calls\": " << s.calls
+			    << ", \"wall_s\": " << s.wall << ", \"cpu_s\": " << s.cpu
+			    << ", \"entries\": " << s.counters.entries << ", \"samples\": " << s.counters.samples
+			    << ", \"bytes\": " << s.counters.bytes << ", \"points\": " << s.counters.points
+			    << ", \"samples_per_s\": " << s.SamplesPerSecond() << ", \"mb_per_s\": " << s.MBPerSecond()
+			    << ", \"cpu_fraction\": " << s.CPUFraction() << "}";
+		}
+		out << "\n  ]\n}\n";
+	}
+
+	void WriteCSV(std::ostream &out) const
+	{
+		out << "#stage,channel,calls,wall_s,cpu_s,entries,samples,bytes,points,samples_per_s,mb_per_s,cpu_fraction\n";
+		for( auto const &s : Stats() ) {
+			out << std::setprecision(9) << s.stage << "," << s.channel << "," << s.calls << ","
+			    << s.wall << "," << s.cpu << "," << s.counters.entries << "," << s.counters.samples << ","
+			    << s.counters.bytes << "," << s.counters.points << "," << s.SamplesPerSecond() << ","
+			    << s.MBPerSecond() << "," << s.CPUFraction() << "\n";
+		}
+	}
+
+	// Writes <base>.json and <base>.csv
+	void Write(const std::string &base) const
+	{
+		std::ofstream json(base + ".json");
+		WriteJSON(json);
+		std::ofstream csv(base + ".csv");
+		WriteCSV(csv);
+	}
+
+	static double CPUTime(CPU_CLOCK clock)
+	{
+		timespec ts;
+		clock_gettime((clock == CPU_CLOCK::THREAD) ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts);
+		return ts.tv_sec + 1e-9*ts.tv_nsec;
+	}
+
+private:
+	std::string                             fProgram;
+	mutable std::mutex                      fMutex;
+	std::vector<StageStats>                 fStats;
+	std::map<std::pair<std::string, int>, size_t> fIndex;
+};
+
+#endif
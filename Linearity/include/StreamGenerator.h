@@ -0,0 +1,61 @@
+#ifndef STREAM_GENERATOR_H
+#define STREAM_GENERATOR_H
+
+#include "DataSmpl.h"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+enum class SIGNAL_SHAPE
+{
+	RAMP,     // rises over every gate, baseline in between
+	SINE,     // free-running sine wave, gate keeps toggling
+	BASELINE  // offset and noise only
+};
+
+struct GeneratorConfig
+{
+	SIGNAL_SHAPE  shape             = SIGNAL_SHAPE::RAMP;
+	std::uint64_t samples           = 1u << 24;
+	unsigned      samples_per_entry = 4096;
+	unsigned      tstmp_step        = 1;      // tStmp increment per sample
+	unsigned      gate_on           = 20000;  // [samples]
+	unsigned      gate_off          = 5000;   // [samples]
+	double        amplitude         = 1.9;    // [V], ramps span +-amplitude
+	double        offset            = -0.049; // [V]
+	double        noise_rms         = 5.3e-5; // [V]
+	double        sine_period       = 1000;   // [samples]
+	unsigned      adc_bits          = 18;
+	double        voltage_ref       = 4.096;  // [V]
+	double        dnl_rms           = 0;      // injected code width error [LSB]
+	std::uint64_t seed              = 1;
+};
+
+// Produces SampleStream entries with the tDataSamples layout of the DAQ:
+// gate1 square wave, monotonic tStmp and quantized ch0/ch1 data.
+// ch1 carries the same signal with opposite slope and its own noise.
+class StreamGenerator
+{
+public:
+	explicit StreamGenerator(const GeneratorConfig &config);
+
+	// Fills the next entry; returns false once config.samples have been produced
+	bool Next(tDataSamples &entry);
+
+private:
+	double Analog(std::uint64_t sample, double polarity) const;
+	double Quantize(double volts) const;
+
+	GeneratorConfig                  fConfig;
+	std::uint64_t                    fSample = 0;
+	double                           fLSB;
+	std::mt19937_64                  fRng;
+	std::normal_distribution<double> fNoise;
+	std::vector<double>              fTransitions; // upper transition level of every code, empty without DNL
+};
+
+// Writes config.samples samples as DataTree/SampleStream into file_name
+void WriteSampleStream(const GeneratorConfig &config, const std::string &file_name);
+
+#endif
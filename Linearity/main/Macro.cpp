@@ -5,7 +5,13 @@
 #include "TBox.h"
 #include "TFile.h"
 #include "DataSmpl.h"
+#include "LinearityAnalysis.h"
+#include "ResultsWriter.h"
 #include <ROOT/RNTupleReader.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+#include <ROOT/TSeq.hxx>
+#include <TROOT.h>
+#include <boost/program_options.hpp>
 #include <TStyle.h>
 #include <TF1.h>
 #include <TPaveStats.h>
@@ -19,100 +25,10 @@
 #include <limits>
 #include <fstream>
 #include <utility>
+#include <tuple>
 #include "TRootCanvas.h"
 #include "TGraphErrors.h"
 
-#define OFFSET 20
-enum SOFTWARE_CHANNEL
-{
-	CHAN_0 = 0,
-	CHAN_1 = 1
-};
-
-struct Signal_tStmp
-{
-	unsigned min;
-	unsigned max;
-};
-
-double GetMean(const std::vector<double> &v)
-{
-	double first_moment = std::accumulate(std::begin(v), std::end(v), 0.0);
-	return first_moment / v.size();
-}
-double GetRMS(const std::vector<double> &v, const double mean)
-{
-	double sum = 0.0;
-	for( auto d : v ) {
-		sum += (d - mean)*(d - mean);
-	}
-	sum /= v.size();
-	return TMath::Sqrt( sum );
-}
-
-Signal_tStmp Find_Valid_Signal_Range(ROOT::RNTupleReader* Reader, SOFTWARE_CHANNEL chan)
-{
-	ROOT::RNTupleView<tDataSamples> data = Reader->GetView<tDataSamples>("SampleStream");
-
-	// Fast forward to second cycle
-	bool first_cycle_found          = false;
-	bool end_of_first_cycle_found   = false;
-	double end_of_first_cycle_tstmp = 0;
-	for( auto entry : Reader->GetEntryRange() ) {
-		if(end_of_first_cycle_found==true) break;
-		const auto& gate1    = data(entry).gate1;
-		const auto& tStmp    = data(entry).tStmp;
-		for(size_t index = 0; index < gate1.size(); index++) {
-			auto g = gate1[index];
-			if(first_cycle_found == false) {
-				if(g != 0) {
-					first_cycle_found = true;
-				}
-			} else {
-				if(g == 0) {
-					end_of_first_cycle_found = true;
-					end_of_first_cycle_tstmp = tStmp[index];
-					break;
-				}
-			}
-		}
-	}
-
-	double max = std::numeric_limits<double>::min(); unsigned MaxTimeStamp = 0;
-	double min = std::numeric_limits<double>::max(); unsigned MinTimeStamp = 0;
-	bool gate_found = false;
-	bool range_found= false;
-	for( auto entry : Reader->GetEntryRange() ) {
-		const auto& gate1    = data(entry).gate1;
-		const auto& ch_data  = (chan == CHAN_1) ? data(entry).ch1_data : data(entry).ch0_data;
-		const auto& tStmp    = data(entry).tStmp;
-		if(tStmp[tStmp.size()-1] < end_of_first_cycle_tstmp) continue;
-		if( range_found == true ) break;
-		for(size_t index = 0; index < ch_data.size(); index++) {
-			if(tStmp[index] < end_of_first_cycle_tstmp) continue;
-			if( gate1[index] != 0 ) {
-				gate_found = true;
-				if(ch_data[index] > max) {
-					max = ch_data[index];
-					MaxTimeStamp = tStmp[index];
-				}
-				if(ch_data[index] <= min) {
-					min = ch_data[index];
-					MinTimeStamp = tStmp[index];
-				}
-			} else if(gate_found == true) {
-				range_found = true;
-				break;
-			} else {
-				continue;
-			}
-		}
-	}
-	std::cout << "Max Found to be " << max << " at tStmp: " << MaxTimeStamp << "\n";
-	std::cout << "Min Found to be " << min << " at tStmp: " << MinTimeStamp << "\n";
-	return (MinTimeStamp < MaxTimeStamp) ? Signal_tStmp{MinTimeStamp, MaxTimeStamp} : Signal_tStmp{MaxTimeStamp, MinTimeStamp};
-}
-
 void divide_canvas_algorithm(TCanvas &c, const int size)
 {
 	[[maybe_unused]]
@@ -132,6 +48,49 @@ void divide_canvas_algorithm(TCanvas &c, const int size)
 
 int main(int argc, char** argv)
 {
+	namespace po = boost::program_options;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h", "Print this message")
+		("threads,j", po::value<unsigned>()->default_value(1), "Worker threads for runs and channels (0: all cores, 1: serial)")
+		("offset", po::value<double>()->default_value(LinearitySettings().offset), "[tStmp] the fit window starts and ends this far inside the extrema")
+		("no-index", "Do not use or create the gate cycle sidecar index (<run>.root.gidx)")
+		("read-ahead", po::value<size_t>()->default_value(4), "Entries decoded ahead of the scan of a run on its own thread (0: decode in the scan)")
+		("report", po::value<std::string>()->default_value("LinearityStats_stages"), "Stage timing report (<report>.json and <report>.csv)")
+		("max-points", po::value<size_t>()->default_value(DISPLAY_MAX_POINTS), "Points kept per range/residual graph (0: all)")
+		("all-cycles", "Also fit every complete gate cycle after the first one, not just the second")
+		("cycles-csv", po::value<std::string>()->default_value("LinearityCycles.csv"), "Per-cycle fit results of --all-cycles")
+		("results", po::value<std::string>()->default_value("LinearityResults.root"), "Fit results and channel state RNTuples (draw with plot_results, combine with merge_results)")
+		("shard", po::value<unsigned>()->default_value(0), "Process the runs with index % shards == shard")
+		("shards", po::value<unsigned>()->default_value(1), "Number of shards the run list is split into")
+		("cache", po::value<std::string>()->default_value(".linearity_cache"), "Per-channel results of earlier jobs; runs whose file and settings did not change are not decoded again")
+		("no-cache", "Neither read nor write the result cache")
+		("canvases", "Also draw the canvases and write them to LinearityStats.root (no longer written without it, the fit results are in --results)");
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+	if(vm.count("help")) {
+		std::cout << desc << "\n";
+		return 0;
+	}
+	const unsigned nThreads = vm["threads"].as<unsigned>();
+	LinearitySettings settings;
+	settings.offset     = vm["offset"].as<double>();
+	settings.use_index  = vm.count("no-index") == 0;
+	settings.read_ahead = vm["read-ahead"].as<size_t>();
+	settings.max_points = vm["max-points"].as<size_t>();
+	settings.all_cycles = vm.count("all-cycles") > 0;
+	const bool     all_cycles = settings.all_cycles;
+	const bool     canvases   = vm.count("canvases") > 0;
+	if(!canvases) std::cerr << "Note: LinearityStats.root is only written with --canvases, the fit results are in " << vm["results"].as<std::string>() << "\n";
+	const unsigned shard      = vm["shard"].as<unsigned>();
+	const unsigned shards     = vm["shards"].as<unsigned>();
+	if(shards == 0 || shard >= shards) {
+		std::cerr << "--shard has to be below --shards\n";
+		return 1;
+	}
+	StageReport    report("Macro");
+	auto total_timer = report.Stage("total", -1, CPU_CLOCK::PROCESS);
 	
 	// Open File
 	std::vector<std::string> vFiles = {
@@ -145,7 +104,41 @@ int main(int argc, char** argv)
 		"../Rootfiles/moller_stream_molleradcse05_119.root",
 	};
 
-	const size_t N_ADC_CHAN = 2*vFiles.size();
+	// Software channel (ch0, ch1) -> ADC channel of every run, in the order of vFiles
+	const ChannelMap channel_map({
+		{ 1,  0},
+		{ 3,  2},
+		{ 5,  4},
+		{ 7,  6},
+		{ 9,  8},
+		{11, 10},
+		{13, 12},
+		{15, 14},
+	});
+	if(channel_map.Runs() != vFiles.size()) {
+		std::cerr << "ChannelMap has " << channel_map.Runs() << " runs for " << vFiles.size() << " files\n";
+		return 1;
+	}
+	const size_t N_ADC_CHAN = channel_map.size();
+	// Indices into vFiles of the runs of this shard
+	std::vector<unsigned> runs;
+	for(unsigned run = shard; run < vFiles.size(); run += shards) runs.push_back(run);
+
+	const ResultCache cache(vm.count("no-cache") ? "" : vm["cache"].as<std::string>());
+	const std::string cache_config = LinearityCacheConfig(settings);
+	std::vector<PerChannel<std::string>> cache_keys(vFiles.size());  // empty: do not store
+	std::vector<ChannelResult> cached_results;
+	std::vector<CycleFit>      cached_cycles;
+	// Runs to decode: not cached, changed, or needed for the range and residual canvases
+	std::vector<unsigned>      fresh;
+	{
+		auto cache_timer = report.Stage("cache lookup");
+		for( auto const run : runs ) {
+			if(!LookupRun(cache, vFiles[run], run, channel_map, cache_config, !canvases, cache_keys[run], cached_results, cached_cycles)) fresh.push_back(run);
+		}
+	}
+	if(cache.Enabled()) std::cout << "Result cache: " << runs.size() - fresh.size() << " of " << runs.size() << " runs unchanged\n";
+
 	auto cResidualMeans = std::make_unique<TCanvas>("ResidualMeans");
 	auto gResidualMeans = std::make_unique<TGraphErrors>();
 
@@ -171,106 +164,168 @@ int main(int argc, char** argv)
 	}
 
 
-	auto fsave = std::make_unique<TFile>("LinearityStats.root", "RECREATE");
+	std::unique_ptr<TFile> fsave;
+	if(canvases) fsave = std::make_unique<TFile>("LinearityStats.root", "RECREATE");
 
-	int adc_channel = -2;
-	for( auto const &file_name : vFiles )
+	std::unique_ptr<ROOT::TThreadExecutor> pool;
+	if(nThreads != 1) {
+		ROOT::EnableThreadSafety();
+		pool = std::make_unique<ROOT::TThreadExecutor>(nThreads);
+	}
+	// Every task opens its own reader; a single pass over a file serves both channels
+	// and, with --all-cycles, every cycle of the run
+	std::vector<std::vector<CycleFit>> fresh_cycles(fresh.size());
+	auto scanners = MapTasks(pool.get(), fresh.size(), [&vFiles, &fresh, &settings, &report, &fresh_cycles](unsigned task) {
+		auto scanner = ScanRun(vFiles[fresh[task]], settings, &report, settings.all_cycles ? &fresh_cycles[task] : nullptr);
+		for( auto &fit : fresh_cycles[task] ) fit.run = fresh[task];
+		return scanner;
+	});
+
+	auto results = MapTasks(pool.get(), fresh.size()*N_SOFT_CHAN, [&](unsigned task) {
+		const unsigned run         = fresh[task / N_SOFT_CHAN];
+		const SOFTWARE_CHANNEL chan= (SOFTWARE_CHANNEL)(task % N_SOFT_CHAN);
+		const size_t slot          = channel_map.Slot(run, chan);
+		// The range and residual graphs are only drawn on the canvases
+		ChannelResult result = AnalyzeChannel(scanners[task / N_SOFT_CHAN], chan, channel_map.AdcChannel(run, chan), settings,
+		                                      canvases ? gRange[slot].get() : nullptr, canvases ? gResidual[slot].get() : nullptr, &report);
+		result.run  = run;
+		result.slot = slot;
+		return result;
+	});
+	const size_t fresh_results = results.size();
+	results.insert(results.end(), cached_results.begin(), cached_results.end());
+	std::stable_sort(results.begin(), results.end(), [](const ChannelResult &a, const ChannelResult &b) {
+		return std::tie(a.run, a.chan) < std::tie(b.run, b.chan);
+	});
+
+	// Merge in the fixed channel order so the output does not depend on scheduling
+	auto draw_timer = report.Stage("draw");
+	for( auto const &result : results )
 	{
-		std::unique_ptr<ROOT::RNTupleReader> Reader = ROOT::RNTupleReader::Open("DataTree",file_name.c_str());
-		adc_channel += 3;
-		for(int i = 0; i < 2; i++) {
-			SOFTWARE_CHANNEL chan = (SOFTWARE_CHANNEL)i;
-			adc_channel -= chan;
-			std::cout << "adc_channel: " << adc_channel << std::endl;
-
-			const Signal_tStmp extrema = Find_Valid_Signal_Range(Reader.get(), chan);
-
-			// Draw +-10% to check
-			cRange->cd(adc_channel+1);
-			std::vector<double> voltage;
-			std::vector<double> timestamps;
-			ROOT::RNTupleView<tDataSamples> data = Reader->GetView<tDataSamples>("SampleStream");
-			for( auto entry : Reader->GetEntryRange() ) {
-				const auto& ch_data  = (chan == CHAN_1) ? data(entry).ch1_data : data(entry).ch0_data;
-				const auto& tStmp    = data(entry).tStmp;
-				if(tStmp[tStmp.size()-1] < extrema.min) continue;
-				for(size_t index = 0; index < ch_data.size(); index++) {
-					if(tStmp[index] >= extrema.min-10 && tStmp[index] <= extrema.max+10) {
-						gRange[adc_channel]->AddPoint(tStmp[index], ch_data[index]);
-						if(tStmp[index] >= extrema.min+OFFSET && tStmp[index] <= extrema.max-OFFSET) {
-							voltage.push_back( ch_data[index] );
-							timestamps.push_back( tStmp[index] );
-							// std::cout << ch_data[index] << "\t" << tStmp[index] << std::endl;
-						}
-					}
-				}
-			}
-			gRange[adc_channel]->SetTitle(Form("Soft. Chan %d vs Time; tStmp [ms]; ch%d_data",chan, chan));
-			gRange[adc_channel]->Draw("AP");
-
-			// Fit with the exact range we care about
-			TF1* fit = new TF1(Form("fit_adc_chan%d", adc_channel), "pol1", extrema.min+OFFSET, extrema.max-OFFSET);
-			gRange[adc_channel]->Fit(fit, "R");
-
-			// Draw slope vs Chan
-			cSlope->cd();
-			gSlope->AddPointError(adc_channel, fit->GetParameter(1), 0, fit->GetParError(1));
-			gSlope->SetTitle("Slope Vs ADC Chan; ADC Chan; Slope");
-			gSlope->SetMarkerStyle(8);
-			gSlope->Draw("AP");
-
-			// Draw Intercept vs Chan
-			cIntercept->cd();
-			gIntercept->AddPointError(adc_channel, fit->GetParameter(0), 0, fit->GetParError(0));
-			gIntercept->SetTitle("Intercept Vs ADC Chan; ADC Chan; Intercept");
-			gIntercept->SetMarkerStyle(8);
-			gIntercept->Draw("AP");
-
-
-			// Compute Residual
-			cResidual->cd(adc_channel+1);
-			std::vector<double> residual;
-			for( size_t index = 0; index < voltage.size(); index++ ) {
-				double time   = timestamps[index];
-				double actual = voltage[index];
-				double eval   = fit->Eval(time);
-				auto res = residual.insert(std::end(residual), eval - actual);
-				// std::cout << residual_counter << "\t" << residual << "\n";
-				gResidual[adc_channel]->AddPoint(time,*res);
+		const int adc_channel = result.adc_channel;
+		std::cout << "adc_channel: " << adc_channel << std::endl;
+		std::cout << "Max Found to be " << result.extrema.max << " at tStmp: " << result.extrema.MaxTimeStamp << "\n";
+		std::cout << "Min Found to be " << result.extrema.min << " at tStmp: " << result.extrema.MinTimeStamp << "\n";
+		std::cout << "Avg Residual: " << result.avg_residual << "\n";
+		std::cout << "RMS: " << result.rms_residual << "\n";
+		if(!canvases) continue;
+
+		cRange->cd(result.slot+1);
+		gRange[result.slot]->Draw("AP");
+
+		// Draw slope vs Chan
+		cSlope->cd();
+		gSlope->AddPointError(adc_channel, result.slope, 0, result.slope_error);
+		gSlope->SetTitle("Slope Vs ADC Chan; ADC Chan; Slope");
+		gSlope->SetMarkerStyle(8);
+		gSlope->Draw("AP");
+
+		// Draw Intercept vs Chan
+		cIntercept->cd();
+		gIntercept->AddPointError(adc_channel, result.intercept, 0, result.intercept_error);
+		gIntercept->SetTitle("Intercept Vs ADC Chan; ADC Chan; Intercept");
+		gIntercept->SetMarkerStyle(8);
+		gIntercept->Draw("AP");
+
+		cResidual->cd(result.slot+1);
+		gResidual[result.slot]->Draw("AP");
+
+		cResidualMeans->cd();
+		gResidualMeans->AddPointError(adc_channel, result.avg_residual, 0, result.rms_residual);
+		gResidualMeans->SetTitle("Mean vs ADC Chan; ADC Chan; #mu_{residual}");
+		gResidualMeans->SetMarkerStyle(8);
+		gResidualMeans->Draw("AP");
+	}
+
+	draw_timer.Stop();
+
+	// Every cycle of every run, fitted during the scan
+	auto cSlopeDrift = std::make_unique<TCanvas>("cSlopeDrift");
+	std::vector<CycleFit> cycle_fits;
+	if(all_cycles) {
+		// The cached cycles are sorted in
+		for( auto const &fits : fresh_cycles ) cycle_fits.insert(cycle_fits.end(), fits.begin(), fits.end());
+		cycle_fits.insert(cycle_fits.end(), cached_cycles.begin(), cached_cycles.end());
+		std::stable_sort(cycle_fits.begin(), cycle_fits.end(), [](const CycleFit &a, const CycleFit &b) {
+			return std::tie(a.run, a.cycle, a.chan) < std::tie(b.run, b.cycle, b.chan);
+		});
+
+		WriteCyclesCSV(vm["cycles-csv"].as<std::string>(), cycle_fits, channel_map);
+		std::vector<std::vector<CycleFit>> channel_fits(N_ADC_CHAN);
+		for( auto const &fit : cycle_fits ) channel_fits[channel_map.Slot(fit.run, fit.chan)].push_back(fit);
+
+		divide_canvas_algorithm(*cSlopeDrift, N_ADC_CHAN);
+		for(size_t slot = 0; slot < N_ADC_CHAN; slot++) {
+			const int adc_channel = channel_map.AdcChannelAt(slot);
+			// Channels of other shards
+			if(channel_fits[slot].empty()) continue;
+			const CycleSummary summary = Summarize(channel_fits[slot]);
+			std::cout << "adc_channel " << adc_channel << ": " << summary.cycles << " cycles\n";
+			std::cout << "  Slope: " << summary.weighted_slope << " +- " << summary.weighted_slope_error
+			          << " (spread " << summary.slope_spread << ", drift " << summary.slope_drift << " +- " << summary.slope_drift_error << " /tStmp)\n";
+			std::cout << "  Intercept: " << summary.weighted_intercept << " +- " << summary.weighted_intercept_error
+			          << " (spread " << summary.intercept_spread << ")\n";
+			std::cout << "  Mean residual RMS: " << summary.mean_rms_residual << "\n";
+			if(!canvases) continue;
+
+			auto gDrift = new TGraphErrors();
+			for( auto const &fit : channel_fits[slot] ) {
+				gDrift->AddPointError(fit.start_tstmp, fit.slope, 0, fit.slope_error);
 			}
-			double avg_residual = GetMean(residual);
-			double rms_residual = GetRMS(residual, avg_residual);
-
-			gResidual[adc_channel]->SetTitle(Form("Residual Vs ADC Chan%d; ADC Chan %d; Residual", adc_channel,adc_channel));
-			gResidual[adc_channel]->Draw("AP");	
-			std::cout << "Avg Residual: " << avg_residual << "\n";
-			std::cout << "RMS: " << rms_residual << "\n";
-
-			cResidualMeans->cd();
-			gResidualMeans->AddPointError(adc_channel, avg_residual, 0, rms_residual);
-			gResidualMeans->SetTitle("Mean vs ADC Chan; ADC Chan; #mu_{residual}");
-			gResidualMeans->SetMarkerStyle(8);
-			gResidualMeans->Draw("AP");
+			gDrift->SetTitle(Form("Slope Vs Cycle ADC Chan %d; Gate start tStmp [ms]; Slope", adc_channel));
+			gDrift->SetMarkerStyle(8);
+			cSlopeDrift->cd(slot+1);
+			gDrift->Draw("AP");
 		}
 	}
 
-	cResidualMeans->Write("cResidual");
-	// gResidualMeans->Write();
+	// Entries for the decoded channels, so the next job skips their runs
+	if(cache.Enabled() && fresh_results > 0) {
+		auto store_timer = report.Stage("cache store");
+		for( auto const &result : results ) {
+			const std::string &key = cache_keys[result.run][result.chan];
+			if(key.empty() || std::find(fresh.begin(), fresh.end(), result.run) == fresh.end()) continue;
+			if(!StoreChannel(cache, key, result, cycle_fits, vFiles[result.run])) std::cerr << "Warning: could not cache " << vFiles[result.run] << " ch" << result.chan << "\n";
+		}
+	}
 
-	cResidual->Write();
-	for(int i = 0; i < 2; i++) {
-		// gResidual[i]->Write();
+	auto write_timer = report.Stage("write");
+	{
+		ResultsWriter results_out(vm["results"].as<std::string>());
+		for( auto const &result : results ) {
+			results_out.Fill(Record(result, vFiles[result.run]));
+			results_out.Fill(State(result, vFiles[result.run]));
+		}
+		for( auto const &fit : cycle_fits ) {
+			results_out.Fill(Record(fit, vFiles[fit.run], channel_map.AdcChannel(fit.run, fit.chan)));
+		}
 	}
+	if(canvases) {
+		cResidualMeans->Write("cResidual");
+		// gResidualMeans->Write();
 
-	cIntercept->Write("cIntercept");
-	// gIntercept->Write();
+		cResidual->Write();
+		for(int i = 0; i < 2; i++) {
+			// gResidual[i]->Write();
+		}
 
-	cSlope->Write("cSlope");
-	// gSlope->Write();
+		cIntercept->Write("cIntercept");
+		// gIntercept->Write();
 
+		cSlope->Write("cSlope");
+		// gSlope->Write();
 
-	cRange->Write("cRange");
-	for(int i = 0; i < 2; i++) {
-  		// gRange[i]->Write();
+
+		if(all_cycles) cSlopeDrift->Write("cSlopeDrift");
+
+		cRange->Write("cRange");
+		for(int i = 0; i < 2; i++) {
+	  		// gRange[i]->Write();
+		}
 	}
+	write_timer.Stop();
+
+	total_timer.Stop();
+	report.Print();
+	report.Write(vm["report"].as<std::string>());
 }
@@ -0,0 +1,241 @@
+#include "BaselineAnalysis.h"
+#include "LinearityAnalysis.h"
+#include "ResultsWriter.h"
+#include <ROOT/TThreadExecutor.hxx>
+#include <TROOT.h>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Runs the baseline, linearity and cycle analyses of a run list in one process:
+// ROOT, the dictionaries and the thread pool are set up once for every run,
+// and a new run list is a new config file instead of a rebuild of Macro.
+// Example: ./batch daily.cfg -j 0
+//
+// daily.cfg (any option may also be given on the command line, which wins):
+//   threads    = 0
+//   cache      = .batch_cache
+//   [baseline]
+//   pattern    = ../Rootfiles/Int_Run_%03d.root
+//   run        = 16 1 2          # run number (or file) and the ADC channels of ch0, ch1
+//   run        = 17 3 4
+//   output     = Baseline        # Baseline.csv, Baseline.root, Baseline_state.root
+//   [linearity]
+//   run        = ../Rootfiles/moller_stream_molleradcse05_110.root 1 0
+//   offset     = 20
+//   cycles     = true            # also fit every gate cycle
+//   results    = LinearityResults.root
+
+struct RunList
+{
+	std::vector<std::string>              files;
+	std::vector<ChannelMap::RunChannels>  adc_chan;
+};
+
+// "<file or run number> <ADC channel of ch0> <ADC channel of ch1>" per line;
+// run numbers are expanded with pattern
+RunList ParseRuns(const std::vector<std::string> &lines, const std::string &pattern)
+{
+	RunList runs;
+	for( auto const &line : lines ) {
+		std::istringstream fields(line);
+		std::string source;
+		ChannelMap::RunChannels adc_chan;
+		fields >> source;
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) fields >> adc_chan[chan];
+		std::string extra;
+		if(!fields || (fields >> extra)) throw std::invalid_argument("Malformed run \"" + line + "\", expected <file or run number> <adc ch0> <adc ch1>");
+		const bool number = !source.empty() && std::all_of(source.begin(), source.end(), [](char c) { return c >= '0' && c <= '9'; });
+		if(number && pattern.empty()) throw std::invalid_argument("Run number " + source + " without a pattern");
+		runs.files.push_back(number ? Form(pattern.c_str(), std::stoi(source)) : source);
+		runs.adc_chan.push_back(adc_chan);
+	}
+	return runs;
+}
+
+void RunBaseline(const RunList &runs, const BaselineSettings &settings, const std::string &output, const ResultCache &cache, StageReport &report)
+{
+	const ChannelMap channel_map(runs.adc_chan);
+	const auto states = BaselineStates(runs.files, channel_map, settings, cache, report);
+	auto write_timer = report.Stage("baseline write");
+	WriteBaselineSummary(states, output);
+	ResultsWriter state_out(output + "_state.root");
+	for( auto const &state : states ) state_out.Fill(state);
+	std::cout << "Baseline: " << states.size() << " channels written to " << output << ".csv\n";
+}
+
+void RunLinearity(ROOT::TThreadExecutor* pool, const RunList &runs, const LinearitySettings &settings, const std::string &results_name,
+                  const std::string &cycles_csv, const ResultCache &cache, StageReport &report)
+{
+	const ChannelMap channel_map(runs.adc_chan);
+	const auto &files = runs.files;
+
+	std::vector<PerChannel<std::string>> cache_keys(files.size());
+	std::vector<ChannelResult> results;
+	std::vector<CycleFit>      cycle_fits;
+	std::vector<unsigned>      fresh;
+	{
+		auto cache_timer = report.Stage("cache lookup");
+		const std::string config = LinearityCacheConfig(settings);
+		for(unsigned run = 0; run < files.size(); run++) {
+			if(!LookupRun(cache, files[run], run, channel_map, config, true, cache_keys[run], results, cycle_fits)) fresh.push_back(run);
+		}
+	}
+	if(cache.Enabled()) std::cout << "Result cache: " << files.size() - fresh.size() << " of " << files.size() << " linearity runs unchanged\n";
+
+	// One task per run scans it once and fits both channels, and every cycle in the same pass;
+	// batch mode draws no graphs
+	std::vector<std::vector<CycleFit>> fresh_cycles(fresh.size());
+	auto fresh_results = MapTasks(pool, fresh.size(), [&](unsigned task) {
+		const unsigned run = fresh[task];
+		const RampScanner scanner = ScanRun(files[run], settings, &report, settings.all_cycles ? &fresh_cycles[task] : nullptr);
+		for( auto &fit : fresh_cycles[task] ) fit.run = run;
+		std::vector<ChannelResult> channels;
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+			ChannelResult result = AnalyzeChannel(scanner, (SOFTWARE_CHANNEL)chan, channel_map.AdcChannel(run, chan), settings, nullptr, nullptr, &report);
+			result.run  = run;
+			result.slot = channel_map.Slot(run, chan);
+			channels.push_back(result);
+		}
+		return channels;
+	});
+	for( auto const &channels : fresh_results ) results.insert(results.end(), channels.begin(), channels.end());
+	std::stable_sort(results.begin(), results.end(), [](const ChannelResult &a, const ChannelResult &b) {
+		return std::tie(a.run, a.chan) < std::tie(b.run, b.chan);
+	});
+
+	if(settings.all_cycles) {
+		for( auto const &fits : fresh_cycles ) cycle_fits.insert(cycle_fits.end(), fits.begin(), fits.end());
+		std::stable_sort(cycle_fits.begin(), cycle_fits.end(), [](const CycleFit &a, const CycleFit &b) {
+			return std::tie(a.run, a.cycle, a.chan) < std::tie(b.run, b.cycle, b.chan);
+		});
+		WriteCyclesCSV(cycles_csv, cycle_fits, channel_map);
+	}
+
+	for( auto const &result : results ) {
+		std::cout << "adc_channel " << result.adc_channel << ": slope " << result.slope << " +- " << result.slope_error
+		          << ", intercept " << result.intercept << " +- " << result.intercept_error << ", RMS residual " << result.rms_residual << "\n";
+	}
+	if(settings.all_cycles) {
+		std::vector<std::vector<CycleFit>> channel_fits(channel_map.size());
+		for( auto const &fit : cycle_fits ) channel_fits[channel_map.Slot(fit.run, fit.chan)].push_back(fit);
+		for(size_t slot = 0; slot < channel_fits.size(); slot++) {
+			if(channel_fits[slot].empty()) continue;
+			const CycleSummary summary = Summarize(channel_fits[slot]);
+			std::cout << "adc_channel " << channel_map.AdcChannelAt(slot) << ": " << summary.cycles << " cycles, slope "
+			          << summary.weighted_slope << " +- " << summary.weighted_slope_error << " (drift " << summary.slope_drift
+			          << " +- " << summary.slope_drift_error << " /tStmp)\n";
+		}
+	}
+
+	if(cache.Enabled() && !fresh.empty()) {
+		auto store_timer = report.Stage("cache store");
+		for( auto const &result : results ) {
+			const std::string &key = cache_keys[result.run][result.chan];
+			if(key.empty() || std::find(fresh.begin(), fresh.end(), result.run) == fresh.end()) continue;
+			if(!StoreChannel(cache, key, result, cycle_fits, files[result.run])) std::cerr << "Warning: could not cache " << files[result.run] << " ch" << result.chan << "\n";
+		}
+	}
+
+	auto write_timer = report.Stage("linearity write");
+	ResultsWriter results_out(results_name);
+	for( auto const &result : results ) {
+		results_out.Fill(Record(result, files[result.run]));
+		results_out.Fill(State(result, files[result.run]));
+	}
+	for( auto const &fit : cycle_fits ) {
+		results_out.Fill(Record(fit, files[fit.run], channel_map.AdcChannel(fit.run, fit.chan)));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	LinearitySettings linearity;
+	BaselineSettings  baseline;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h",       "Print this message")
+		("config",       po::value<std::string>(), "Run list and settings")
+		("threads,j",    po::value<unsigned>()->default_value(1), "Worker threads of every analysis (0: all cores, 1: serial)")
+		("read-ahead",   po::value<size_t>(&linearity.read_ahead)->default_value(linearity.read_ahead), "Entries decoded ahead of a scan on its own thread (0: decode in the scan)")
+		("cache",        po::value<std::string>()->default_value(".batch_cache"), "Per-channel results of earlier jobs, shared by the analyses (\"\": off)")
+		("report",       po::value<std::string>()->default_value("batch_stages"), "Stage timing report (<report>.json and <report>.csv)")
+		("baseline.pattern",    po::value<std::string>()->default_value(""), "Baseline file name of a run number, e.g. ../Rootfiles/Int_Run_%03d.root")
+		("baseline.run",        po::value<std::vector<std::string>>()->composing(), "<file or run number> <adc ch0> <adc ch1>, once per run")
+		("baseline.adc-bits",   po::value<unsigned>(&baseline.adc_bits)->default_value(baseline.adc_bits), "ADC resolution, sets the histogram bins")
+		("baseline.chain-runs", po::value<bool>(&baseline.chain_runs)->default_value(baseline.chain_runs), "One event loop over every run")
+		("baseline.output",     po::value<std::string>()->default_value("Baseline"), "<output>.csv, <output>.root and <output>_state.root")
+		("linearity.pattern",   po::value<std::string>()->default_value(""), "Ramp file name of a run number")
+		("linearity.run",       po::value<std::vector<std::string>>()->composing(), "<file or run number> <adc ch0> <adc ch1>, once per run")
+		("linearity.offset",    po::value<double>(&linearity.offset)->default_value(linearity.offset), "[tStmp] the fit window starts and ends this far inside the extrema")
+		("linearity.index",     po::value<bool>(&linearity.use_index)->default_value(linearity.use_index), "Use and create the gate cycle sidecar index")
+		("linearity.cycles",    po::value<bool>(&linearity.all_cycles)->default_value(linearity.all_cycles), "Also fit every complete gate cycle after the first one")
+		("linearity.cycles-csv",po::value<std::string>()->default_value("LinearityCycles.csv"), "Per-cycle fit results")
+		("linearity.results",   po::value<std::string>()->default_value("LinearityResults.root"), "Fit results and channel state RNTuples");
+	po::positional_options_description positional;
+	positional.add("config", 1);
+	po::variables_map vm;
+	try {
+		// The command line is stored first, so it overrides the config file
+		po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+		if(vm.count("config")) {
+			std::ifstream config(vm["config"].as<std::string>());
+			if(!config) throw std::runtime_error("Can not open " + vm["config"].as<std::string>());
+			po::store(po::parse_config_file(config, desc), vm);
+		}
+		po::notify(vm);
+	}
+	catch(const std::exception &error) {
+		std::cerr << error.what() << "\n";
+		return 1;
+	}
+	if(vm.count("help") || (!vm.count("baseline.run") && !vm.count("linearity.run"))) {
+		std::cout << "Usage: batch [options] config\n" << desc << "\n";
+		return 0;
+	}
+
+	RunList baseline_runs, linearity_runs;
+	try {
+		if(vm.count("baseline.run"))  baseline_runs  = ParseRuns(vm["baseline.run"].as<std::vector<std::string>>(),  vm["baseline.pattern"].as<std::string>());
+		if(vm.count("linearity.run")) linearity_runs = ParseRuns(vm["linearity.run"].as<std::vector<std::string>>(), vm["linearity.pattern"].as<std::string>());
+	}
+	catch(const std::exception &error) {
+		std::cerr << error.what() << "\n";
+		return 1;
+	}
+
+	StageReport report("batch");
+	auto total_timer = report.Stage("total", -1, CPU_CLOCK::PROCESS);
+	// Once for every analysis: RDataFrame runs on the implicit MT pool, the scans and fits
+	// on the executor, which shares its threads
+	const unsigned nThreads = vm["threads"].as<unsigned>();
+	std::unique_ptr<ROOT::TThreadExecutor> pool;
+	if(nThreads != 1) {
+		ROOT::EnableThreadSafety();
+		ROOT::EnableImplicitMT(nThreads);
+		pool = std::make_unique<ROOT::TThreadExecutor>(nThreads);
+	}
+	const ResultCache cache(vm["cache"].as<std::string>());
+
+	if(!baseline_runs.files.empty()) {
+		RunBaseline(baseline_runs, baseline, vm["baseline.output"].as<std::string>(), cache, report);
+	}
+	if(!linearity_runs.files.empty()) {
+		RunLinearity(pool.get(), linearity_runs, linearity, vm["linearity.results"].as<std::string>(),
+		             vm["linearity.cycles-csv"].as<std::string>(), cache, report);
+	}
+	if(cache.Enabled()) std::cout << "Result cache: " << cache.Hits() << " hits, " << cache.Misses() << " misses\n";
+
+	total_timer.Stop();
+	report.Print();
+	report.Write(vm["report"].as<std::string>());
+	return 0;
+}
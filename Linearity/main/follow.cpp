@@ -0,0 +1,256 @@
+#include "SampleStream.h"
+#include "RampScanner.h"
+#include "CycleFit.h"
+#include "StageTimer.h"
+#include "ResultCache.h"
+#include <ROOT/RNTupleReader.hxx>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Live tail of SampleStream runs while the DAQ is still writing them: baseline
+// mean/RMS of every channel and the slope of every completed gate cycle,
+// published every few seconds. Each file is re-opened only when it changed on
+// disk and analysis resumes at the first entry not seen yet, so an update costs
+// what was added since the last one, not the whole file.
+// RNTupleWriter only writes the anchor when the DAQ commits the dataset, so a file
+// that is still being written can not be opened and is invisible until that commit.
+// Following a directory picks up each new file once it is committed.
+// Example: ./follow ../Rootfiles --interval 5 --csv live.csv
+
+// Mean and spread of every sample seen, merged entry by entry (Chan et al.)
+struct RunningMoments
+{
+	std::uint64_t n    = 0;
+	double        mean = 0;
+	double        m2   = 0;  // sum of squared deviations from mean
+
+	void Add(const double* x, size_t count)
+	{
+		if(count == 0) return;
+		double sum = 0;
+		for(size_t i = 0; i < count; i++) sum += x[i];
+		const double mean_b = sum/count;
+		double m2_b = 0;
+		for(size_t i = 0; i < count; i++) m2_b += (x[i] - mean_b)*(x[i] - mean_b);
+		const double total = double(n) + count;
+		const double delta = mean_b - mean;
+		m2   += m2_b + delta*delta*n*count/total;
+		mean += delta*count/total;
+		n    += count;
+	}
+	// As TH1::GetStdDev() of the baseline histograms
+	double RMS() const { return (n > 0) ? std::sqrt(m2/n) : 0; }
+};
+
+// Slope of the last cycle and the inverse-variance weighted slope of all of them
+struct CycleTrend
+{
+	size_t   cycles = 0;
+	CycleFit last;
+	double   sum_w  = 0, sum_wx = 0;
+
+	void Add(const CycleFit &fit)
+	{
+		cycles++;
+		last = fit;
+		if(fit.slope_error > 0) {
+			const double w = 1/(fit.slope_error*fit.slope_error);
+			sum_w  += w;
+			sum_wx += w*fit.slope;
+		}
+	}
+	double Slope()      const { return (sum_w > 0) ? sum_wx/sum_w : last.slope; }
+	double SlopeError() const { return (sum_w > 0) ? 1/std::sqrt(sum_w) : 0; }
+};
+
+struct FollowedRun
+{
+	std::string                     file;
+	std::uintmax_t                  size  = 0;
+	std::filesystem::file_time_type mtime;
+	ROOT::NTupleSize_t              next  = 0;     // first entry not analyzed yet
+	std::uint64_t                   anchor_hash = 0;  // SourceIdentity, changes when the file is rewritten
+	bool                            readable = false;
+	PerChannel<RunningMoments>      baseline;
+	RampScanner                     scanner;       // follows the gate cycle by cycle
+	PerChannel<CycleTrend>          trend;
+};
+
+// Analyzes the entries committed to run.file since the last call.
+// Returns the number of new entries, 0 if the file did not change or can not be read yet.
+ROOT::NTupleSize_t Update(FollowedRun &run, double offset, StageReport &report)
+{
+	std::error_code ec;
+	const auto size  = std::filesystem::file_size(run.file, ec);
+	if(ec) return 0;
+	const auto mtime = std::filesystem::last_write_time(run.file, ec);
+	if(ec || (size == run.size && mtime == run.mtime)) return 0;
+
+	auto open_timer = report.Stage("open");
+	std::unique_ptr<ROOT::RNTupleReader> Reader;
+	try {
+		Reader = ROOT::RNTupleReader::Open("DataTree", run.file);
+	}
+	catch(const std::exception&) {
+		// No anchor yet; look again once the file changes
+		run.size  = size;
+		run.mtime = mtime;
+		return 0;
+	}
+	const std::uint64_t anchor_hash = SourceIdentity::Of(run.file).anchor_hash;
+	open_timer.Stop();
+	const ROOT::NTupleSize_t entries = Reader->GetNEntries();
+	if(entries < run.next || (run.readable && anchor_hash != run.anchor_hash)) {
+		// Rewritten, e.g. a new run under the same name, even if it is not shorter
+		const std::string file = run.file;
+		run      = FollowedRun();
+		run.file = file;
+	}
+	run.anchor_hash = anchor_hash;
+	run.size        = size;
+	run.mtime       = mtime;
+	run.readable    = true;
+	if(entries <= run.next) return 0;
+
+	auto timer = report.Stage("update");
+	SampleStreamView data(Reader.get(), ALL_COLUMNS);
+	for(ROOT::NTupleSize_t entry = run.next; entry < entries; entry++) {
+		const EntrySpans spans = data.spans(entry);
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) run.baseline[chan].Add(spans.ch_data[chan].data(), spans.ch_data[chan].size());
+		// The entry that ends a cycle may already open the next one
+		while(!run.scanner.Process(spans)) {
+			for( auto fit : FitScannedCycle(run.scanner, offset) ) {
+				if(fit.n == 0) continue;
+				fit.cycle       = run.trend[fit.chan].cycles;
+				fit.start_tstmp = run.scanner.GateOpenTimeStamp();
+				run.trend[fit.chan].Add(fit);
+			}
+			run.scanner.NextCycle();
+		}
+		const size_t n = spans.tStmp.size();
+		timer.Entries(1).Samples(N_SOFT_CHAN*n).Bytes(n*(sizeof(gate_vector_t::value_type) + sizeof(tStmp_vector_t::value_type) + N_SOFT_CHAN*sizeof(data_vector_t::value_type)));
+	}
+	const ROOT::NTupleSize_t added = entries - run.next;
+	run.next = entries;
+	return added;
+}
+
+// Files to follow: every path given, and the .root files containing match in every directory given
+std::vector<std::string> ListRuns(const std::vector<std::string> &paths, const std::string &match)
+{
+	std::vector<std::string> files;
+	for( auto const &path : paths ) {
+		std::error_code ec;
+		if(!std::filesystem::is_directory(path, ec)) {
+			files.push_back(path);
+			continue;
+		}
+		std::vector<std::string> found;
+		for( auto const &item : std::filesystem::directory_iterator(path, ec) ) {
+			const std::string name = item.path().filename().string();
+			if(item.path().extension() == ".root" && name.find(match) != std::string::npos) found.push_back(item.path().string());
+		}
+		std::sort(found.begin(), found.end());
+		files.insert(files.end(), found.begin(), found.end());
+	}
+	return files;
+}
+
+// Rewritten whole on every update and renamed into place, so readers never see half a table
+void Publish(const std::vector<std::unique_ptr<FollowedRun>> &runs, const std::string &csv)
+{
+	const std::string partial = csv + ".partial";
+	{
+		std::ofstream fcsv(partial);
+		fcsv << "#File,Soft_Chan,Entries,Samples,Mean,RMS,Cycles,Last_Slope,Last_Slope_Error,Slope,Slope_Error\n";
+		fcsv << std::setprecision(10);
+		for( auto const &run : runs ) {
+			for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+				const RunningMoments &baseline = run->baseline[chan];
+				const CycleTrend     &trend    = run->trend[chan];
+				fcsv << run->file << "," << chan << "," << run->next << "," << baseline.n << "," << baseline.mean << "," << baseline.RMS() << ","
+				     << trend.cycles << "," << trend.last.slope << "," << trend.last.slope_error << "," << trend.Slope() << "," << trend.SlopeError() << "\n";
+			}
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(partial, csv, ec);
+}
+
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h",     "Print this message")
+		("interval",   po::value<double>()->default_value(5), "[s] between updates")
+		("idle-exit",  po::value<double>()->default_value(0), "[s] without new entries after which to stop (0: follow until killed)")
+		("match",      po::value<std::string>()->default_value("moller_stream_"), "Part of the name of the files followed in a directory")
+		("offset",     po::value<double>()->default_value(20), "[tStmp] the cycle fit window starts and ends this far inside the extrema")
+		("csv",        po::value<std::string>()->default_value("follow.csv"), "Per-channel numbers, rewritten on every update")
+		("report",     po::value<std::string>()->default_value("follow_stages"), "Stage timing report written on exit (<report>.json and <report>.csv)")
+		("paths",      po::value<std::vector<std::string>>(), "Files or directories of runs being written");
+	po::positional_options_description positional;
+	positional.add("paths", -1);
+	po::variables_map vm;
+	po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+	po::notify(vm);
+	if(vm.count("help") || !vm.count("paths")) {
+		std::cout << "Usage: follow [options] files or directories...\n" << desc << "\n";
+		return 0;
+	}
+	const auto   paths     = vm["paths"].as<std::vector<std::string>>();
+	const auto   interval  = std::chrono::duration<double>(vm["interval"].as<double>());
+	const double idle_exit = vm["idle-exit"].as<double>();
+	const double offset    = vm["offset"].as<double>();
+	const std::string match = vm["match"].as<std::string>();
+	StageReport report("follow");
+
+	std::vector<std::unique_ptr<FollowedRun>> runs;
+	std::set<std::string> known;
+	auto last_growth = std::chrono::steady_clock::now();
+	for(auto next_update = std::chrono::steady_clock::now();; next_update += std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval)) {
+		std::this_thread::sleep_until(next_update);
+		for( auto const &file : ListRuns(paths, match) ) {
+			if(!known.insert(file).second) continue;
+			runs.push_back(std::make_unique<FollowedRun>());
+			runs.back()->file = file;
+			std::cout << "Following " << file << "\n";
+		}
+
+		ROOT::NTupleSize_t added = 0;
+		for( auto &run : runs ) added += Update(*run, offset, report);
+		const auto now = std::chrono::steady_clock::now();
+		if(added > 0) last_growth = now;
+
+		if(added > 0) {
+			Publish(runs, vm["csv"].as<std::string>());
+			for( auto const &run : runs ) {
+				if(!run->readable) continue;
+				for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+					const CycleTrend &trend = run->trend[chan];
+					std::cout << run->file << " ch" << chan << ": " << run->next << " entries, mean " << run->baseline[chan].mean
+					          << ", RMS " << run->baseline[chan].RMS() << ", " << trend.cycles << " cycles";
+					if(trend.cycles > 0) std::cout << ", slope " << trend.last.slope << " (all " << trend.Slope() << " +- " << trend.SlopeError() << ")";
+					std::cout << "\n";
+				}
+			}
+		}
+		if(idle_exit > 0 && std::chrono::duration<double>(now - last_growth).count() >= idle_exit) break;
+	}
+
+	report.Print();
+	report.Write(vm["report"].as<std::string>());
+	return 0;
+}
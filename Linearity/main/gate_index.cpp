@@ -0,0 +1,56 @@
+#include "GateIndex.h"
+#include <ROOT/RNTupleReader.hxx>
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <iomanip>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Builds (or checks) the gate cycle sidecar index of run files.
+// Example: ./gate_index ../Rootfiles/moller_stream_molleradcse05_*.root
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h",  "Print this message")
+		("force,f", "Rebuild even if an up to date index exists")
+		("list,l",  "Print every cycle")
+		("files",   po::value<std::vector<std::string>>(), "moller_stream_*.root files");
+	po::positional_options_description positional;
+	positional.add("files", -1);
+	po::variables_map vm;
+	po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+	po::notify(vm);
+	if(vm.count("help") || !vm.count("files")) {
+		std::cout << "Usage: gate_index [options] files...\n" << desc << "\n";
+		return 0;
+	}
+
+	for( auto const &file_name : vm["files"].as<std::vector<std::string>>() ) {
+		std::optional<GateIndex> loaded;
+		if(!vm.count("force")) loaded = GateIndex::Load(file_name);
+		const bool cached = loaded.has_value();
+		GateIndex index;
+		if(cached) {
+			index = *loaded;
+		} else {
+			std::unique_ptr<ROOT::RNTupleReader> Reader = ROOT::RNTupleReader::Open("DataTree", file_name);
+			index = GateIndex::Build(Reader.get(), file_name);
+			if(!index.Save(file_name)) {
+				std::cerr << "Could not write " << GateIndex::SidecarName(file_name) << "\n";
+			}
+		}
+		std::cout << file_name << ": " << index.size() << " gate cycles" << (cached ? " (cached)" : "") << "\n";
+		if(!vm.count("list")) continue;
+		for(size_t cycle = 0; cycle < index.size(); cycle++) {
+			const auto& c = index[cycle];
+			std::cout << std::setw(6) << cycle
+			          << "  entry " << c.start_entry << ":" << c.start_index << " tStmp " << c.start_tstmp
+			          << "  ->  entry " << c.end_entry << ":" << c.end_index << " tStmp " << c.end_tstmp
+			          << (c.complete ? "" : "  (open)") << "\n";
+		}
+	}
+	return 0;
+}
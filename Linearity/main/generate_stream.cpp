@@ -0,0 +1,58 @@
+#include "StreamGenerator.h"
+#include "SampleStream.h"
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <string>
+
+// Writes a synthetic moller_stream-like run for offline tests and benchmarks.
+// Example: ./generate_stream -o ../Rootfiles/synthetic_ramp.root --size 500 --dnl 0.05
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	GeneratorConfig config;
+	std::string output, shape;
+	double      size_mb = 0;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h", "Print this message")
+		("output,o",  po::value<std::string>(&output)->default_value("synthetic_stream.root"), "Output file")
+		("shape",     po::value<std::string>(&shape)->default_value("ramp"), "ramp, sine or baseline")
+		("samples",   po::value<std::uint64_t>(&config.samples)->default_value(config.samples), "Samples per channel")
+		("size",      po::value<double>(&size_mb), "Uncompressed size [MB], overrides --samples")
+		("per-entry", po::value<unsigned>(&config.samples_per_entry)->default_value(config.samples_per_entry), "Samples per entry")
+		("tstmp-step",po::value<unsigned>(&config.tstmp_step)->default_value(config.tstmp_step), "tStmp increment per sample")
+		("gate-on",   po::value<unsigned>(&config.gate_on)->default_value(config.gate_on), "Gate open [samples]")
+		("gate-off",  po::value<unsigned>(&config.gate_off)->default_value(config.gate_off), "Gate closed [samples]")
+		("amplitude", po::value<double>(&config.amplitude)->default_value(config.amplitude), "Ramp/sine amplitude [V]")
+		("offset",    po::value<double>(&config.offset)->default_value(config.offset), "Baseline [V]")
+		("noise",     po::value<double>(&config.noise_rms)->default_value(config.noise_rms), "Gaussian noise RMS [V]")
+		("period",    po::value<double>(&config.sine_period)->default_value(config.sine_period), "Sine period [samples]")
+		("bits",      po::value<unsigned>(&config.adc_bits)->default_value(config.adc_bits), "ADC resolution")
+		("vref",      po::value<double>(&config.voltage_ref)->default_value(config.voltage_ref), "ADC reference [V]")
+		("dnl",       po::value<double>(&config.dnl_rms)->default_value(config.dnl_rms), "Injected DNL RMS [LSB]")
+		("seed",      po::value<std::uint64_t>(&config.seed)->default_value(config.seed), "Random seed");
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+	if(vm.count("help")) {
+		std::cout << desc << "\n";
+		return 0;
+	}
+
+	if(shape == "ramp")          config.shape = SIGNAL_SHAPE::RAMP;
+	else if(shape == "sine")     config.shape = SIGNAL_SHAPE::SINE;
+	else if(shape == "baseline") config.shape = SIGNAL_SHAPE::BASELINE;
+	else {
+		std::cerr << "Unknown shape " << shape << "\n";
+		return 1;
+	}
+	if(size_mb > 0) {
+		// gate1 + tStmp + ch0_data + ch1_data per sample
+		const double bytes_per_sample = sizeof(gate_vector_t::value_type) + sizeof(tStmp_vector_t::value_type) + 2*sizeof(data_vector_t::value_type);
+		config.samples = size_mb * 1024 * 1024 / bytes_per_sample;
+	}
+
+	std::cout << "Writing " << config.samples << " samples (" << shape << ") to " << output << "\n";
+	WriteSampleStream(config, output);
+	return 0;
+}
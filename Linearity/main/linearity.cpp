@@ -4,41 +4,33 @@
 #include "TBox.h"
 #include "TFile.h"
 #include "DataSmpl.h"
+#include "SampleStream.h"
+#include "ReadAhead.h"
+#include "LinearFit.h"
+#include "Residual.h"
+#include "DisplayGraph.h"
+#include "ResultsWriter.h"
+#include "Extrema.h"
+#include "CodeHistogram.h"
+#include "AdcSpec.h"
+#include "StageTimer.h"
 #include <ROOT/RNTupleReader.hxx>
 #include <TStyle.h>
 #include <TF1.h>
 #include <TPaveStats.h>
 #include <TPaveText.h>
+#include <boost/program_options.hpp>
 #include <iostream>
 #include <iomanip>
 #include <memory>
 #include <vector>
 #include <algorithm>
-#include <limits>
+#include <cmath>
 #include <fstream>
 #include <utility>
 
-// std::pow is constexpr in c++26
-// TMath::Power is a wrapper around std::pow
-template<typename T>
-constexpr T power(T base, unsigned exp)
-{
-      T ret = 1;
-      for(unsigned i = 1; i <= exp; i++) {
-          ret *= base;
-     }
-     return ret;
-}
-
-
-constexpr double   VOLTAGE_REF = 4.096;  // [V]
-constexpr double   VOLTAGE_MAX =  (VOLTAGE_REF / 2);
-constexpr double   VOLTAGE_MIN = -(VOLTAGE_REF / 2);
-constexpr unsigned ADC_BITS    = 18;
-constexpr double   LSB         = VOLTAGE_REF / power(2,ADC_BITS);
-constexpr size_t   NBINS       = power(2,ADC_BITS)+1;
-constexpr double   LOWER_BIN   = -power(2,ADC_BITS-1)-0.5;
-constexpr double   UPPER_BIN   =  power(2,ADC_BITS-1)+0.5;
+// Half width of the residual histogram in units of the fit spread
+static constexpr double RESIDUAL_RANGE_SIGMA = 6;
 
 enum class SOFTWARE_CHANNEL : int
 {
@@ -47,49 +39,51 @@ enum class SOFTWARE_CHANNEL : int
 };
 
 // Returns {Min, Max} TimeStamp Values
-std::pair<double, double> GetExtremaTimeStamps(ROOT::RNTupleReader* Reader, const SOFTWARE_CHANNEL CHAN, const size_t tStmp_limit = 6000)
+// stream: the TSTMP and CHAN columns from the first entry on
+std::pair<double, double> GetExtremaTimeStamps(ReadAhead &stream, const SOFTWARE_CHANNEL CHAN, StageReport::Timer &timer, const size_t tStmp_limit = 6000)
 {
-
-	ROOT::RNTupleView<tDataSamples> data = Reader->GetView<tDataSamples>("SampleStream");
-
-	double max = std::numeric_limits<double>::min(); unsigned MaxTimeStamp = 0;
-	double min = std::numeric_limits<double>::max(); unsigned MinTimeStamp = 0;
-	for( auto entry : Reader->GetEntryRange() ) {
-		const auto& ch_data  = (CHAN == SOFTWARE_CHANNEL::CHAN_1) ? data(entry).ch1_data : data(entry).ch0_data;
-		const auto& tStmp    = data(entry).tStmp;
+	ChannelExtrema extrema;
+	while(const EntryBuffer* buffer = stream.Next()) {
+		const auto& tStmp    = buffer->spans.tStmp;
 		if(tStmp[0] > tStmp_limit) break;
-		for(size_t index = 0; index < ch_data.size(); index++) {
-			if(ch_data[index] > max) {
-				max = ch_data[index];
-				MaxTimeStamp = tStmp[index];
-			}
-			if(ch_data[index] < min) {
-				min = ch_data[index];
-				MinTimeStamp = tStmp[index];
-			}
-		}
+		const auto& ch_data  = buffer->spans.ch_data[(unsigned)CHAN];
+		UpdateExtrema(extrema, ch_data.data(), tStmp.data(), ch_data.size());
+		timer.Entries(1).Samples(ch_data.size()).Bytes(ch_data.size()*(sizeof(tStmp_vector_t::value_type) + sizeof(data_vector_t::value_type)));
 	}
-	std::cout << "Max Found to be " << max << " at tStmp: " << MaxTimeStamp << "\n";
-	std::cout << "Min Found to be " << min << " at tStmp: " << MinTimeStamp << "\n";
-	return std::pair{MinTimeStamp, MaxTimeStamp};
+	stream.Stop();
+	std::cout << "Max Found to be " << extrema.max << " at tStmp: " << extrema.MaxTimeStamp << "\n";
+	std::cout << "Min Found to be " << extrema.min << " at tStmp: " << extrema.MinTimeStamp << "\n";
+	return std::pair{extrema.MinTimeStamp, extrema.MaxTimeStamp};
 }
 
-void FillTObject(ROOT::RNTupleReader* Reader, const SOFTWARE_CHANNEL CHAN, TH1F* h, TGraph* g, const std::pair<double, double> &TimeStampExtrema)
+// Points inside TimeStampExtrema also go into fit, and are kept in fit_tStmp/fit_data for the residual
+// stream: the TSTMP and CHAN columns of the entries around TimeStampExtrema
+template<typename ADC>
+void FillTObject(ReadAhead &stream, const SOFTWARE_CHANNEL CHAN, CodeHistogram* h, DisplayGraph* g, LinearFit* fit,
+                 std::vector<double>* fit_tStmp, std::vector<double>* fit_data, const std::pair<double, double> &TimeStampExtrema, StageReport::Timer &timer)
 {
-	ROOT::RNTupleView<tDataSamples> data = Reader->GetView<tDataSamples>("SampleStream");
-
 	auto MinTimeStamp = TimeStampExtrema.first;
 	auto MaxTimeStamp = TimeStampExtrema.second;
 	double tol = 0.1; // 10% tolerance
-	for( auto entry : Reader->GetEntryRange() ) {
-		const auto& ch_data  = (CHAN == SOFTWARE_CHANNEL::CHAN_1) ? data(entry).ch1_data : data(entry).ch0_data;
-		const auto& tStmp    = data(entry).tStmp;
-		if(tStmp[tStmp.size()-1] < MinTimeStamp) continue;
-		if(tStmp[0] > MaxTimeStamp) break;
+	const ROOT::NTupleSize_t first_entry = stream.First();
+	while(const EntryBuffer* buffer = stream.Next()) {
+		const auto& tStmp    = buffer->spans.tStmp;
+		const auto& ch_data  = buffer->spans.ch_data[(unsigned)CHAN];
+		if(buffer->entry == first_entry) {
+			// Every entry of the range may hold fit samples
+			fit_tStmp->reserve(stream.Entries()*ch_data.size());
+			fit_data ->reserve(stream.Entries()*ch_data.size());
+		}
+		timer.Entries(1).Samples(ch_data.size()).Bytes(ch_data.size()*(sizeof(tStmp_vector_t::value_type) + sizeof(data_vector_t::value_type)));
 		for(size_t index = 0; index < ch_data.size(); index++) {
 			if((tStmp[index] > (1.0-tol)*MinTimeStamp) && (tStmp[index]< (1.0+tol)*MaxTimeStamp)) {
 				g->AddPoint(tStmp[index], ch_data[index]);
-				h->Fill( (ch_data[index]/LSB) );
+				h->Fill( ADC::ToCode(ch_data[index]) );
+				if(tStmp[index] >= MinTimeStamp && tStmp[index] <= MaxTimeStamp) {
+					fit->Add(tStmp[index], ch_data[index]);
+					fit_tStmp->push_back(tStmp[index]);
+					fit_data->push_back(ch_data[index]);
+				}
 			}
 		}
 	}
@@ -97,14 +91,28 @@ void FillTObject(ROOT::RNTupleReader* Reader, const SOFTWARE_CHANNEL CHAN, TH1F*
 }
 
 
-int main()
+template<typename ADC>
+int Analyze(const std::string &file_name, int run, int adc_chan, const std::string &report_name, const std::string &results_name, size_t max_points, size_t read_ahead, bool canvases)
 {
-	std::unique_ptr<ROOT::RNTupleReader> Reader = ROOT::RNTupleReader::Open("DataTree", "../Rootfiles/moller_stream_molleradcse05_96.root");
+	StageReport report("linearity");
+	auto total_timer = report.Stage("total", -1, CPU_CLOCK::PROCESS);
+	const int CHAN = (int)SOFTWARE_CHANNEL::CHAN_0;
+	std::unique_ptr<ROOT::RNTupleReader> Reader = ROOT::RNTupleReader::Open("DataTree", file_name);
 
-	auto RampHist = std::make_unique<TH1F>("Ramp", "Ramp Histogram; LSB; Cts", NBINS, LOWER_BIN, UPPER_BIN);
-	auto RampGraph= std::make_unique<TGraph>();
-	auto TimeStampExtrema = GetExtremaTimeStamps(Reader.get(), SOFTWARE_CHANNEL::CHAN_0);
-	FillTObject(Reader.get(), SOFTWARE_CHANNEL::CHAN_0, RampHist.get(), RampGraph.get(), TimeStampExtrema);
+	auto RampHist = CodeHistogram::For<ADC>();
+	DisplayGraph RampDisplay(max_points);
+	LinearFit RampFit;
+	std::vector<double> FitTimeStamps, FitData;
+	auto extrema_timer = report.Stage("extrema", CHAN);
+	const unsigned columns = TSTMP | ChannelColumn(CHAN);
+	ReadAhead extrema_stream(file_name, columns, Reader->GetEntryRange(), read_ahead);
+	auto TimeStampExtrema = GetExtremaTimeStamps(extrema_stream, SOFTWARE_CHANNEL::CHAN_0, extrema_timer);
+	extrema_timer.CPU(extrema_stream.ProducerCPU()).Stop();
+	auto fill_timer = report.Stage("fill", CHAN);
+	ReadAhead fill_stream(file_name, columns, SeekTimeRange(Reader.get(), TimeStampExtrema.first, TimeStampExtrema.second), read_ahead);
+	FillTObject<ADC>(fill_stream, SOFTWARE_CHANNEL::CHAN_0, &RampHist, &RampDisplay, &RampFit, &FitTimeStamps, &FitData, TimeStampExtrema, fill_timer);
+	auto RampGraph = RampDisplay.ToTGraph();
+	fill_timer.Points(RampGraph->GetN()).CPU(fill_stream.ProducerCPU()).Stop();
 
 	auto canvas    = std::make_unique<TCanvas>();
 	canvas->Divide(1,2);
@@ -112,8 +120,12 @@ int main()
 	RampGraph->Draw();
 	RampGraph->SetTitle("Linearity; tStmp [ms]; ch0_data");
 	gStyle->SetOptFit();
+	auto fit_timer = report.Stage("fit", CHAN);
+	fit_timer.Samples(RampFit.N());
 	auto fit = std::make_unique<TF1>("fit", "pol1", TimeStampExtrema.first, TimeStampExtrema.second);
-	RampGraph->Fit(fit.get(), "R");
+	RampFit.Apply(fit.get());
+	fit_timer.Stop();
+	RampGraph->GetListOfFunctions()->Add(fit->Clone());
 	canvas->Modified();
 	canvas->Update();
 	// Move Stats Box
@@ -124,33 +136,30 @@ int main()
 	ps->SetY2NDC(0.95);
 
 	canvas->cd(2);
-	RampHist->Draw();
+	auto hRamp = RampHist.ToTH1("Ramp", "Ramp Histogram; LSB; Cts");
+	hRamp->Draw();
 	canvas->Print();
 
 
-	// Loop over and Compute Residual
-	size_t NPOINTS = RampGraph->GetN();
-	auto gResidual = std::make_unique<TGraph>();
-	for(size_t point = 0; point < NPOINTS; point++) {
-		double time = RampGraph->GetPointX(point);
-		if(time >= TimeStampExtrema.first/0.9 && time <= TimeStampExtrema.second/1.1) {
-			double data = RampGraph->GetPointY(point);
-			double fit_val  = fit->Eval(time);
-			double residual = fit_val - data;
-			gResidual->AddPoint(time, residual);
-			// std::cout << point << "\t" << time << "\t" << residual << std::endl;
-		}
-	}
-
-	NPOINTS = gResidual->GetN();
-	auto hResidual = std::make_unique<TH1F>("hResidual", "Residual Distribution", 1000, 0.9*gResidual->GetMinimum(), gResidual->GetMaximum());
-	for(size_t point = 0; point < NPOINTS; point++) {
-		double data = gResidual->GetPointY(point);
-		hResidual->Fill(data);
-	}
+	// Compute Residual in one pass over the fit samples; they are in tStmp order
+	auto residual_timer = report.Stage("residual", CHAN);
+	const double* time   = FitTimeStamps.data();
+	const size_t first   = std::lower_bound(time, time + FitTimeStamps.size(), TimeStampExtrema.first/0.9) - time;
+	const size_t last    = std::upper_bound(time, time + FitTimeStamps.size(), TimeStampExtrema.second/1.1) - time;
+	const size_t nresidual = (last > first) ? last - first : 0;
+	residual_timer.Samples(nresidual).Bytes(nresidual*2*sizeof(double));
+	// Range from the spread of the fit (sqrt(chi2/ndf), at least an LSB), so the histogram fills in the same pass
+	const double spread  = std::max(ADC::LSB, (RampFit.NDF() > 0) ? std::sqrt(RampFit.Chi2()/RampFit.NDF()) : 0.0);
+	auto hResidual = std::make_unique<TH1F>("hResidual", "Residual Distribution", 1000, -RESIDUAL_RANGE_SIGMA*spread, RESIDUAL_RANGE_SIGMA*spread);
+	DisplayGraph ResidualDisplay(max_points);
+	const ResidualStats residual = LinearResidual(time + first, FitData.data() + first, nresidual,
+	                                              fit->GetParameter(0), fit->GetParameter(1), hResidual.get(), &ResidualDisplay);
+	auto gResidual = ResidualDisplay.ToTGraph();
+	std::cout << "Avg Residual: " << residual.mean << "\n";
+	std::cout << "RMS: " << residual.rms << "\n";
+	residual_timer.Points(gResidual->GetN()).Stop();
 
 
-	auto fsave = std::make_unique<TFile>("./save.root","RECREATE");
 	auto cResidual = std::make_unique<TCanvas>();
 	cResidual->Divide(1,2);
 	cResidual->cd(1);
@@ -160,33 +169,113 @@ int main()
 	cResidual->cd(2);
 	hResidual->Draw();
 
+	if(canvases) {
+		auto fsave = std::make_unique<TFile>("./save.root","RECREATE");
+		gResidual->Write("gResidual");
+		hResidual->Write("hResidual");
+		cResidual->Write("cResidual");
+		canvas->Write("canvas");
+	}
 
-	gResidual->Write("gResidual");
-	hResidual->Write("hResidual");
-	cResidual->Write("cResidual");
-	canvas->Write("canvas");
+	// Code density test over every code the ramp fully covered
+	auto linearity_timer = report.Stage("code density", CHAN);
+	linearity_timer.Samples(RampHist.Entries());
+	const CodeLinearity linearity = RampHist.RampLinearity();
+	linearity_timer.Stop();
+	std::cout << "bin_average = " << linearity.mean_counts << std::endl;
+	std::cout << "max |DNL| = " << linearity.MaxAbsDNL() << " LSB, max |INL| = " << linearity.MaxAbsINL() << " LSB" << std::endl;
 
-	double bin_average = 0; size_t counter = 0;
-	for(size_t bin = 0.2*NBINS; bin < 0.8*NBINS; bin++)
-	{
-		bin_average += RampHist->GetBinContent(bin);
-		counter++;
-	}
-	bin_average /= counter;
-	std::cout << "bin_average = " << bin_average << std::endl;
-
-	auto ResidualGraph = std::make_unique<TGraph>(counter);
-	for(size_t count = 0; count < counter; count++) {
-		size_t bin         = count + 0.2*NBINS;
-		double bin_content = RampHist->GetBinContent(bin);
-		double residual    = bin_average - bin_content;
-		// std::cout << "Average: " << bin_average << "\tbin: " << bin << "\tContent: " << bin_content << "\tResidual: " << residual << std::endl;
-		ResidualGraph->SetPoint(count, bin, residual);
-	}
+	auto DNLGraph = linearity.DNLGraph();
+	auto INLGraph = linearity.INLGraph();
 	auto cResidual2 = std::make_unique<TCanvas>();
-	ResidualGraph->SetMarkerStyle(8);
-	ResidualGraph->Draw("AP");
+	cResidual2->Divide(1,2);
+	cResidual2->cd(1);
+	DNLGraph->SetTitle("DNL; Code [LSB]; DNL [LSB]");
+	DNLGraph->SetMarkerStyle(8);
+	DNLGraph->Draw("AP");
+	cResidual2->cd(2);
+	INLGraph->SetTitle("INL; Code [LSB]; INL [LSB]");
+	INLGraph->SetMarkerStyle(8);
+	INLGraph->Draw("AP");
 	cResidual2->Print("res.ps");
 
+	FitRecord record;
+	record.file            = file_name;
+	record.run             = run;
+	record.soft_chan       = CHAN;
+	record.adc_chan        = adc_chan;
+	record.n               = RampFit.N();
+	record.slope           = RampFit.Slope();
+	record.slope_error     = RampFit.SlopeError();
+	record.intercept       = RampFit.Intercept();
+	record.intercept_error = RampFit.InterceptError();
+	record.avg_residual    = residual.mean;
+	record.rms_residual    = residual.rms;
+	record.min_tstmp       = TimeStampExtrema.first;
+	record.max_tstmp       = TimeStampExtrema.second;
+	record.adc_bits        = ADC::ADC_BITS;
+	record.max_abs_dnl     = linearity.MaxAbsDNL();
+	record.max_abs_inl     = linearity.MaxAbsINL();
+
+	// Fit sums and code counts, so runs of the same channel can be combined by merge_results
+	ChannelState state;
+	state.analysis  = (std::int32_t)STATE_ANALYSIS::LINEARITY;
+	state.adc_chan  = adc_chan;
+	state.soft_chan = CHAN;
+	state.run       = run;
+	state.files     = {file_name};
+	state.SetFit(RampFit);
+	state.SetCodes(RampHist, ADC::LSB);
+
+	ResultsWriter results_out(results_name);
+	results_out.Fill(record);
+	results_out.Fill(state);
+
+	total_timer.Stop();
+	report.Print();
+	report.Write(report_name);
 	return 0;
 }
+
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h", "Print this message")
+		("file,f", po::value<std::string>()->default_value("../Rootfiles/moller_stream_molleradcse05_96.root"), "SampleStream run to analyze")
+		("run", po::value<int>()->default_value(0), "Index of the run in the campaign, to order merged results")
+		("adc-chan", po::value<int>()->default_value(-1), "ADC channel wired to ch0 in this run (-1: unknown, the state is not merged by merge_results)")
+		("bits,b", po::value<unsigned>()->default_value(18), "ADC resolution of the board (16, 18 or 24)")
+		("report", po::value<std::string>()->default_value("linearity_stages"), "Stage timing report (<report>.json and <report>.csv)")
+		("max-points", po::value<size_t>()->default_value(DISPLAY_MAX_POINTS), "Points kept in the ramp and residual graphs (0: all)")
+		("read-ahead", po::value<size_t>()->default_value(4), "Entries decoded ahead of the analysis on their own thread (0: decode in the analysis)")
+		("results", po::value<std::string>()->default_value("linearity_results.root"), "Fit and DNL/INL results RNTuple (draw with plot_results)")
+		("canvases", "Also write the graphs and canvases to save.root (no longer written without it, the fit and DNL/INL results are in --results)");
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+	if(vm.count("help")) {
+		std::cout << desc << "\n";
+		return 0;
+	}
+
+	const std::string report_name = vm["report"].as<std::string>();
+	const size_t      max_points  = vm["max-points"].as<size_t>();
+	const size_t      read_ahead  = vm["read-ahead"].as<size_t>();
+	const std::string results_name= vm["results"].as<std::string>();
+	const bool        canvases    = vm.count("canvases") > 0;
+	const std::string file_name   = vm["file"].as<std::string>();
+	const int         run         = vm["run"].as<int>();
+	const int         adc_chan    = vm["adc-chan"].as<int>();
+	if(!canvases) std::cerr << "Note: save.root is only written with --canvases, the results are in " << results_name << "\n";
+	if(adc_chan < 0) std::cerr << "Warning: no --adc-chan, merge_results will skip the channel state of this run\n";
+	switch(vm["bits"].as<unsigned>()) {
+		case 16: return Analyze<ADC_16BIT>(file_name, run, adc_chan, report_name, results_name, max_points, read_ahead, canvases);
+		case 18: return Analyze<ADC_18BIT>(file_name, run, adc_chan, report_name, results_name, max_points, read_ahead, canvases);
+		case 24: return Analyze<ADC_24BIT>(file_name, run, adc_chan, report_name, results_name, max_points, read_ahead, canvases);
+		default:
+			std::cerr << "No AdcSpec for a " << vm["bits"].as<unsigned>() << " bit board\n";
+			return 1;
+	}
+}
@@ -0,0 +1,126 @@
+#include "ResultsWriter.h"
+#include "BaselineAnalysis.h"
+#include "ChannelState.h"
+#include "CodeHistogram.h"
+#include "LinearFit.h"
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Combines the results files of the shards of a campaign, like hadd:
+// channel states of the same ADC channel are merged, and the summary is
+// derived again from the merged states, as a single job over every run would.
+// Example: ./merge_results -o LinearityResults.root shard_*.root
+//          ./merge_results -o Baseline_state.root --baseline Baseline ../Baseline/shard_*_state.root
+
+// The per-run fit of a merged linearity state, as Macro/linearity write it.
+// The residuals of a least-squares line over its own window have mean 0 and RMS sqrt(chi2/n).
+FitRecord Record(const ChannelState &state)
+{
+	const LinearFit fit = state.Fit();
+	FitRecord record;
+	record.file            = state.files.empty() ? "" : state.files.front();
+	record.run             = state.run;
+	record.soft_chan       = state.soft_chan;
+	record.adc_chan        = state.adc_chan;
+	record.n               = fit.N();
+	record.slope           = fit.Slope();
+	record.slope_error     = fit.SlopeError();
+	record.intercept       = fit.Intercept();
+	record.intercept_error = fit.InterceptError();
+	record.avg_residual    = 0;
+	record.rms_residual    = (fit.N() > 0) ? std::sqrt(fit.Chi2()/fit.N()) : 0;
+	if(state.min <= state.max) {
+		record.min       = state.min;
+		record.min_tstmp = state.min_tstmp;
+		record.max       = state.max;
+		record.max_tstmp = state.max_tstmp;
+	}
+	if(!state.counts.empty()) {
+		const CodeLinearity linearity = state.Codes().RampLinearity();
+		record.adc_bits    = state.adc_bits;
+		record.max_abs_dnl = linearity.MaxAbsDNL();
+		record.max_abs_inl = linearity.MaxAbsINL();
+	}
+	return record;
+}
+
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h",     "Print this message")
+		("output,o",   po::value<std::string>()->default_value("MergedResults.root"), "Merged fit records and channel states")
+		("baseline,b", po::value<std::string>(), "Also write the baseline summary to <baseline>.csv and <baseline>.root")
+		("files",      po::value<std::vector<std::string>>(), "Results files of Macro, linearity or baseline_script shards");
+	po::positional_options_description positional;
+	positional.add("files", -1);
+	po::variables_map vm;
+	po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+	po::notify(vm);
+	if(vm.count("help") || !vm.count("files")) {
+		std::cout << "Usage: merge_results [options] files...\n" << desc << "\n";
+		return 0;
+	}
+
+	// States keyed by analysis and ADC channel; per-cycle records are passed through
+	std::map<std::pair<std::int32_t, std::int32_t>, ChannelState> merged;
+	std::vector<FitRecord> cycle_records;
+	for( auto const &file_name : vm["files"].as<std::vector<std::string>>() ) {
+		const auto states = ReadChannelStates(file_name);
+		if(states.empty()) std::cerr << "Warning: no channel states in " << file_name << " (written before sharding was supported?)\n";
+		for( auto const &state : states ) {
+			if(state.adc_chan < 0) {
+				// Its runs could be of any channel: merging on (analysis, adc_chan) would mix them
+				std::cerr << "Warning: skipping a state without an ADC channel in " << file_name << " (soft_chan " << state.soft_chan << ")\n";
+				continue;
+			}
+			auto [found, inserted] = merged.emplace(std::make_pair(state.analysis, state.adc_chan), state);
+			if(!inserted) found->second.Merge(state);
+		}
+		for( auto const &record : ReadFitRecords(file_name) ) {
+			if(record.cycle >= 0) cycle_records.push_back(record);
+		}
+	}
+
+	// The order of a single job: run list order, then software channel
+	std::vector<ChannelState> states;
+	for( auto &[key, state] : merged ) states.push_back(std::move(state));
+	std::stable_sort(states.begin(), states.end(), [](const ChannelState &a, const ChannelState &b) {
+		return std::tie(a.analysis, a.run, a.soft_chan) < std::tie(b.analysis, b.run, b.soft_chan);
+	});
+	std::stable_sort(cycle_records.begin(), cycle_records.end(), [](const FitRecord &a, const FitRecord &b) {
+		return std::tie(a.run, a.cycle) < std::tie(b.run, b.cycle);
+	});
+
+	std::vector<ChannelState> baseline;
+	{
+		ResultsWriter results_out(vm["output"].as<std::string>());
+		for( auto const &state : states ) {
+			results_out.Fill(state);
+			if(state.analysis == (std::int32_t)STATE_ANALYSIS::BASELINE) {
+				baseline.push_back(state);
+				continue;
+			}
+			const FitRecord record = Record(state);
+			std::cout << "adc_channel " << record.adc_chan << " (" << state.files.size() << " files): slope " << record.slope << " +- " << record.slope_error
+			          << ", intercept " << record.intercept << " +- " << record.intercept_error << "\n";
+			results_out.Fill(record);
+		}
+		for( auto const &record : cycle_records ) results_out.Fill(record);
+	}
+	std::cout << "Merged " << states.size() << " channel states and " << cycle_records.size() << " cycle fits into " << vm["output"].as<std::string>() << "\n";
+
+	if(vm.count("baseline")) {
+		WriteBaselineSummary(baseline, vm["baseline"].as<std::string>());
+	} else if(!baseline.empty()) {
+		std::cout << baseline.size() << " baseline channels, pass --baseline for their summary\n";
+	}
+	return 0;
+}
@@ -0,0 +1,136 @@
+#include "ResultsWriter.h"
+#include <ROOT/RNTupleReader.hxx>
+#include <TCanvas.h>
+#include <TFile.h>
+#include <TGraphErrors.h>
+#include <boost/program_options.hpp>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Draws the canvases of Macro/linearity from their results RNTuples, only when asked for.
+// Example: ./plot_results LinearityResults.root --output LinearityStats.root --print plots
+void divide_canvas_algorithm(TCanvas &c, const int size)
+{
+	int row = 1, col = 1;
+	while(row*col < size) {
+		col++;
+		if(row < col)
+		{
+			row++;
+			col--;
+		}
+
+	}
+	c.Divide(row,col);
+}
+
+void ConfigureGraph(TGraph* g, const char* title)
+{
+	g->SetTitle(title);
+	g->SetMarkerStyle(8);
+}
+
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h",   "Print this message")
+		("output,o", po::value<std::string>()->default_value("LinearityPlots.root"), "ROOT file for the canvases")
+		("print,p",  po::value<std::string>(), "Also print every canvas to <print>_<canvas>.ps")
+		("files",    po::value<std::vector<std::string>>(), "Results files written by Macro or linearity");
+	po::positional_options_description positional;
+	positional.add("files", -1);
+	po::variables_map vm;
+	po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+	po::notify(vm);
+	if(vm.count("help") || !vm.count("files")) {
+		std::cout << "Usage: plot_results [options] files...\n" << desc << "\n";
+		return 0;
+	}
+
+	// Per-run fits against ADC channel, in file order for trends
+	auto gSlope     = new TGraphErrors();
+	auto gIntercept = new TGraphErrors();
+	auto gResidual  = new TGraphErrors();
+	auto gDNL       = new TGraphErrors();
+	auto gINL       = new TGraphErrors();
+	// Per-cycle slopes against gate start, per ADC channel
+	std::map<int, TGraphErrors*> gDrift;
+
+	size_t n_records = 0;
+	for( auto const &file_name : vm["files"].as<std::vector<std::string>>() ) {
+		auto Reader = ROOT::RNTupleReader::Open(ResultsWriter::NTUPLE_NAME, file_name);
+		auto fit    = Reader->GetView<FitRecord>(ResultsWriter::FIELD_NAME);
+		for( auto entry : Reader->GetEntryRange() ) {
+			const FitRecord &record = fit(entry);
+			n_records++;
+			if(record.cycle >= 0) {
+				auto &graph = gDrift[record.adc_chan];
+				if(graph == nullptr) graph = new TGraphErrors();
+				graph->AddPointError(record.start_tstmp, record.slope, 0, record.slope_error);
+				continue;
+			}
+			gSlope    ->AddPointError(record.adc_chan, record.slope,        0, record.slope_error);
+			gIntercept->AddPointError(record.adc_chan, record.intercept,    0, record.intercept_error);
+			gResidual ->AddPointError(record.adc_chan, record.avg_residual, 0, record.rms_residual);
+			if(!std::isnan(record.max_abs_dnl)) {
+				gDNL->AddPoint(gDNL->GetN(), record.max_abs_dnl);
+				gINL->AddPoint(gINL->GetN(), record.max_abs_inl);
+			}
+		}
+	}
+	std::cout << "Read " << n_records << " fit records\n";
+
+	auto fsave = std::make_unique<TFile>(vm["output"].as<std::string>().c_str(), "RECREATE");
+	std::vector<TCanvas*> canvases;
+
+	auto cSlope = new TCanvas("cSlope");
+	ConfigureGraph(gSlope, "Slope Vs ADC Chan; ADC Chan; Slope");
+	gSlope->Draw("AP");
+	canvases.push_back(cSlope);
+
+	auto cIntercept = new TCanvas("cIntercept");
+	ConfigureGraph(gIntercept, "Intercept Vs ADC Chan; ADC Chan; Intercept");
+	gIntercept->Draw("AP");
+	canvases.push_back(cIntercept);
+
+	auto cResidual = new TCanvas("cResidual");
+	ConfigureGraph(gResidual, "Mean vs ADC Chan; ADC Chan; #mu_{residual}");
+	gResidual->Draw("AP");
+	canvases.push_back(cResidual);
+
+	if(gDNL->GetN() > 0) {
+		auto cCodeDensity = new TCanvas("cCodeDensity");
+		cCodeDensity->Divide(1,2);
+		cCodeDensity->cd(1);
+		ConfigureGraph(gDNL, "Max |DNL|; Result; |DNL| [LSB]");
+		gDNL->Draw("AP");
+		cCodeDensity->cd(2);
+		ConfigureGraph(gINL, "Max |INL|; Result; |INL| [LSB]");
+		gINL->Draw("AP");
+		canvases.push_back(cCodeDensity);
+	}
+
+	if(!gDrift.empty()) {
+		auto cSlopeDrift = new TCanvas("cSlopeDrift");
+		divide_canvas_algorithm(*cSlopeDrift, gDrift.size());
+		int pad = 1;
+		for( auto const &[adc_chan, graph] : gDrift ) {
+			cSlopeDrift->cd(pad++);
+			ConfigureGraph(graph, Form("Slope Vs Cycle ADC Chan %d; Gate start tStmp [ms]; Slope", adc_chan));
+			graph->Draw("AP");
+		}
+		canvases.push_back(cSlopeDrift);
+	}
+
+	for( auto canvas : canvases ) {
+		canvas->Write();
+		if(vm.count("print")) canvas->Print(Form("%s_%s.ps", vm["print"].as<std::string>().c_str(), canvas->GetName()));
+	}
+	return 0;
+}
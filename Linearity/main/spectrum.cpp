@@ -0,0 +1,166 @@
+#include "SampleStream.h"
+#include "ReadAhead.h"
+#include "Spectrum.h"
+#include "StageTimer.h"
+#include <ROOT/RNTupleReader.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+#include <ROOT/TSeq.hxx>
+#include <TROOT.h>
+#include <TFile.h>
+#include <TH1D.h>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Dynamic performance (SNR, SINAD, SFDR, ENOB) of sine wave runs from Welch averaged spectra.
+// Example: ./spectrum ../Rootfiles/synthetic_sine.root -j 0 --segment 65536 --csv sine.csv
+
+struct SpectrumSettings
+{
+	size_t          segment    = 1 << 16;
+	double          overlap    = 0.5;
+	SPECTRUM_WINDOW window     = SPECTRUM_WINDOW::BLACKMAN_HARRIS;
+	unsigned        tasks      = 1;
+	size_t          read_ahead = 4;
+};
+
+// Sample rate [Hz] from the tStmp spacing of the first entry
+double SampleRate(ROOT::RNTupleReader* Reader, double tstmp_unit)
+{
+	SampleStreamView data(Reader, TSTMP);
+	const auto& tStmp = data.tStmp(*Reader->GetEntryRange().begin());
+	if(tStmp.size() < 2 || tStmp.back() <= tStmp.front()) return 0;
+	const double spacing = double(tStmp.back() - tStmp.front())/(tStmp.size() - 1);
+	return 1/(spacing*tstmp_unit);
+}
+
+// Splits the entries of file into settings.tasks ranges, each streamed through its own
+// spectra, and merges them. A task drops the incomplete segment at the end of its range.
+// One spectrum per software channel.
+std::vector<WelchSpectrum> RunSpectra(ROOT::TThreadExecutor* pool, const std::string &file_name, ROOT::NTupleSize_t entries,
+                                     const SpectrumSettings &settings, StageReport &report)
+{
+	const unsigned tasks = std::max<unsigned>(1, std::min<ROOT::NTupleSize_t>(settings.tasks, entries));
+	auto Task = [&](unsigned task) {
+		const ROOT::NTupleSize_t first = entries*task/tasks;
+		const ROOT::NTupleSize_t last  = entries*(task + 1)/tasks;
+		auto timer = report.Stage("spectra");
+		std::vector<WelchSpectrum> spectra;
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) spectra.emplace_back(settings.segment, settings.overlap, settings.window);
+		ReadAhead stream(file_name, ALL_CHANNELS, ROOT::RNTupleGlobalRange(first, last), settings.read_ahead);
+		while(const EntryBuffer* buffer = stream.Next()) {
+			for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+				spectra[chan].Add(buffer->spans.ch_data[chan].data(), buffer->spans.ch_data[chan].size());
+			}
+			const size_t n = buffer->spans.ch_data[0].size();
+			timer.Entries(1).Samples(N_SOFT_CHAN*n).Bytes(N_SOFT_CHAN*n*sizeof(data_vector_t::value_type));
+		}
+		timer.CPU(stream.ProducerCPU());
+		return spectra;
+	};
+	std::vector<std::vector<WelchSpectrum>> results;
+	if(pool != nullptr) {
+		results = pool->Map(Task, ROOT::TSeqU(tasks));
+	} else {
+		for(unsigned task = 0; task < tasks; task++) results.push_back(Task(task));
+	}
+
+	// Merge in task order
+	auto merge_timer = report.Stage("merge");
+	std::vector<WelchSpectrum> merged = std::move(results[0]);
+	for(size_t task = 1; task < results.size(); task++) {
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) merged[chan].Merge(results[task][chan]);
+	}
+	return merged;
+}
+
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	SpectrumSettings settings;
+	std::string window;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h",      "Print this message")
+		("threads,j",   po::value<unsigned>()->default_value(1), "Worker threads (0: all cores, 1: serial)")
+		("tasks",       po::value<unsigned>()->default_value(0), "Entry ranges a run is split into (0: one per thread)")
+		("segment",     po::value<size_t>(&settings.segment)->default_value(settings.segment), "FFT segment length [samples]")
+		("overlap",     po::value<double>(&settings.overlap)->default_value(settings.overlap), "Fraction of a segment shared with the next one")
+		("window",      po::value<std::string>(&window)->default_value("blackman-harris"), "hann or blackman-harris")
+		("harmonics",   po::value<unsigned>()->default_value(5), "Highest harmonic counted as distortion")
+		("sample-rate", po::value<double>()->default_value(0), "Sample rate [Hz] (0: from the tStmp spacing)")
+		("tstmp-unit",  po::value<double>()->default_value(1e-3), "Seconds per tStmp count")
+		("read-ahead",  po::value<size_t>(&settings.read_ahead)->default_value(settings.read_ahead), "Entries decoded ahead per task (0: decode in the task)")
+		("csv",         po::value<std::string>()->default_value("spectrum.csv"), "Metrics of every channel")
+		("output,o",    po::value<std::string>()->default_value("spectrum.root"), "Amplitude spectral densities")
+		("report",      po::value<std::string>()->default_value("spectrum_stages"), "Stage timing report (<report>.json and <report>.csv)")
+		("files",       po::value<std::vector<std::string>>(), "Sine wave runs");
+	po::positional_options_description positional;
+	positional.add("files", -1);
+	po::variables_map vm;
+	po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+	po::notify(vm);
+	if(vm.count("help") || !vm.count("files")) {
+		std::cout << "Usage: spectrum [options] files...\n" << desc << "\n";
+		return 0;
+	}
+	if(window == "hann")                 settings.window = SPECTRUM_WINDOW::HANN;
+	else if(window == "blackman-harris") settings.window = SPECTRUM_WINDOW::BLACKMAN_HARRIS;
+	else {
+		std::cerr << "Unknown window " << window << "\n";
+		return 1;
+	}
+
+	const unsigned nThreads  = vm["threads"].as<unsigned>();
+	const unsigned harmonics = vm["harmonics"].as<unsigned>();
+	StageReport report("spectrum");
+	auto total_timer = report.Stage("total", -1, CPU_CLOCK::PROCESS);
+
+	std::unique_ptr<ROOT::TThreadExecutor> pool;
+	if(nThreads != 1) {
+		ROOT::EnableThreadSafety();
+		pool = std::make_unique<ROOT::TThreadExecutor>(nThreads);
+	}
+	settings.tasks = vm["tasks"].as<unsigned>();
+	if(settings.tasks == 0) settings.tasks = pool ? pool->GetPoolSize() : 1;
+
+	std::ofstream fcsv(vm["csv"].as<std::string>());
+	fcsv << "#File,Soft_Chan,Segments,Frequency,Signal,Noise,Distortion,Noise_Density,SNR,SINAD,THD,SFDR,ENOB\n";
+	auto fsave = std::make_unique<TFile>(vm["output"].as<std::string>().c_str(), "RECREATE");
+
+	for( auto const &file_name : vm["files"].as<std::vector<std::string>>() ) {
+		std::unique_ptr<ROOT::RNTupleReader> Reader = ROOT::RNTupleReader::Open("DataTree", file_name);
+		double sample_rate = vm["sample-rate"].as<double>();
+		if(sample_rate <= 0) sample_rate = SampleRate(Reader.get(), vm["tstmp-unit"].as<double>());
+		if(sample_rate <= 0) {
+			std::cerr << "No sample rate for " << file_name << ", pass --sample-rate\n";
+			return 1;
+		}
+
+		auto spectra = RunSpectra(pool.get(), file_name, Reader->GetNEntries(), settings, report);
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+			const SpectrumMetrics metrics = spectra[chan].Analyze(sample_rate, harmonics);
+			std::cout << file_name << " ch" << chan << ": " << spectra[chan].Segments() << " segments, f = " << metrics.frequency << " Hz"
+			          << std::setprecision(4) << ", SNR = " << metrics.snr << " dB, SINAD = " << metrics.sinad << " dB, SFDR = " << metrics.sfdr
+			          << " dBc, ENOB = " << metrics.enob << std::setprecision(6) << "\n";
+			fcsv << std::setprecision(9) << file_name << "," << chan << "," << spectra[chan].Segments() << "," << metrics.frequency << ","
+			     << metrics.signal << "," << metrics.noise << "," << metrics.distortion << "," << metrics.noise_density << ","
+			     << metrics.snr << "," << metrics.sinad << "," << metrics.thd << "," << metrics.sfdr << "," << metrics.enob << "\n";
+
+			const std::string name = file_name.substr(file_name.find_last_of('/') + 1);
+			auto hist = spectra[chan].ToTH1(Form("hASD_%s_ch%u", name.c_str(), chan), Form("%s ch%u; f [Hz]; ASD [V/#sqrt{Hz}]", name.c_str(), chan), sample_rate);
+			fsave->cd();
+			hist->Write();
+		}
+	}
+
+	total_timer.Stop();
+	report.Print();
+	report.Write(vm["report"].as<std::string>());
+	return 0;
+}
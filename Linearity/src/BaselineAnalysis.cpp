@@ -0,0 +1,153 @@
+#include "BaselineAnalysis.h"
+#include "LSBHistogram.h"
+#include <ROOT/RDataFrame.hxx>
+#include <TFile.h>
+#include <TFitResult.h>
+#include <TGraphErrors.h>
+#include <TH1D.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+static const char* TTREE_NAME = "DataTree";
+
+enum GAUSS_FIT_PARAMS
+{
+	AMPLITUDE = 0,
+	MEAN,
+	RMS
+};
+
+std::vector<ChannelState> BaselineStates(const std::vector<std::string> &files, const ChannelMap &channel_map, const BaselineSettings &settings,
+                                         const ResultCache &cache, StageReport &report)
+{
+	const double lsb = ADC_18BIT::VOLTAGE_REF / (1L << settings.adc_bits);
+	std::vector<ChannelState> states(files.size()*N_SOFT_CHAN);
+	std::vector<std::string>  keys(states.size());  // empty: do not store
+	std::vector<bool>         cached(states.size(), false);
+
+	// A run is only read if one of its channels misses the cache
+	const std::string config = Form("baseline adc_bits=%u", settings.adc_bits);
+	std::vector<unsigned>    fresh;
+	std::vector<std::string> fresh_files;
+	auto cache_timer = report.Stage("cache lookup");
+	for(unsigned run = 0; run < files.size(); run++) {
+		const SourceIdentity source = cache.Enabled() ? SourceIdentity::Of(files[run], TTREE_NAME) : SourceIdentity();
+		unsigned hits = 0;
+		for(unsigned chan = 0; chan < N_SOFT_CHAN && source.size > 0; chan++) {
+			const size_t entry = N_SOFT_CHAN*run + chan;
+			keys[entry] = cache.Key(source, chan, channel_map.AdcChannel(run, chan), config);
+			const auto hit = cache.Load(keys[entry]);
+			if(!hit || hit->states.size() != 1) continue;
+			states[entry] = hit->states.front();
+			hits++;
+		}
+		if(hits == N_SOFT_CHAN) {
+			for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) cached[N_SOFT_CHAN*run + chan] = true;
+			continue;
+		}
+		fresh.push_back(run);
+		fresh_files.push_back(files[run]);
+	}
+	cache_timer.Stop();
+	if(cache.Enabled()) std::cout << "Result cache: " << files.size() - fresh.size() << " of " << files.size() << " baseline runs unchanged\n";
+
+	std::vector<ROOT::RDataFrame> dataframes;
+	std::vector<ROOT::RDF::RResultPtr<TH1D>> histograms;
+	std::vector<ROOT::RDF::RResultPtr<ULong64_t>> counts;
+	auto Book = [&](ROOT::RDF::RNode node, unsigned run) {
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+			LSBHistogramHelper helper(Form("hRun%u_ch%u", run, chan), Form("SampleStream.%s", CHANNEL_MEMBER_NAMES[chan]), lsb);
+			histograms.emplace_back( node.Book<ROOT::RVecD>(std::move(helper), {Form("SampleStream.%s", CHANNEL_MEMBER_NAMES[chan])}) );
+		}
+		counts.emplace_back( node.Count() );
+	};
+	auto open_timer = report.Stage("open");
+	if(fresh.empty()) {
+		// Everything cached, no event loop
+	}
+	else if(settings.chain_runs) {
+		auto &df = dataframes.emplace_back(TTREE_NAME, fresh_files);
+		// Index into fresh of the file an entry comes from; sample ids read "<file>/<tree>"
+		auto indexed = df.DefinePerSample("run_index", [fresh_files](unsigned int, const ROOT::RDF::RSampleInfo &id) {
+			const std::string sample = id.AsString();
+			for(unsigned index = 0; index < fresh_files.size(); index++) {
+				if(sample.rfind(fresh_files[index] + "/", 0) == 0) return index;
+			}
+			throw std::runtime_error("Entry from unknown sample " + sample);
+		});
+		for(unsigned index = 0; index < fresh.size(); index++) {
+			Book(indexed.Filter([index](unsigned run_index) { return run_index == index; }, {"run_index"}), fresh[index]);
+		}
+	}
+	else {
+		for(unsigned index = 0; index < fresh.size(); index++) {
+			Book(dataframes.emplace_back(TTREE_NAME, fresh_files[index]), fresh[index]);
+		}
+	}
+	open_timer.Stop();
+
+	if(!histograms.empty()) {
+		auto loop_timer = report.Stage("event loop", -1, CPU_CLOCK::PROCESS);
+		std::vector<ROOT::RDF::RResultHandle> handles(histograms.begin(), histograms.end());
+		handles.insert(handles.end(), counts.begin(), counts.end());
+		ROOT::RDF::RunGraphs(handles);
+		for( auto c : counts ) loop_timer.Entries(*c);
+		for( auto h : histograms ) loop_timer.Samples(h->GetEntries()).Bytes(h->GetEntries()*sizeof(double));
+	}
+
+	for(unsigned index = 0; index < fresh.size(); index++) {
+		const unsigned run = fresh[index];
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+			const size_t entry = N_SOFT_CHAN*run + chan;
+			ChannelState &state = states[entry];
+			state = ChannelState();
+			state.analysis  = (std::int32_t)STATE_ANALYSIS::BASELINE;
+			state.adc_chan  = channel_map.AdcChannel(run, chan);
+			state.soft_chan = chan;
+			state.run       = run;
+			state.files     = {files[run]};
+			state.adc_bits  = settings.adc_bits;
+			state.SetHistogram(*histograms[N_SOFT_CHAN*index + chan], lsb);
+			if(keys[entry].empty()) continue;
+			CachedChannel cache_entry;
+			cache_entry.states.push_back(state);
+			if(!cache.Store(keys[entry], cache_entry)) std::cerr << "Warning: could not cache " << files[run] << " ch" << chan << "\n";
+		}
+	}
+	// The run index of a cached state may be from a different run list
+	for(size_t entry = 0; entry < states.size(); entry++) {
+		if(cached[entry]) states[entry].run = entry / N_SOFT_CHAN;
+	}
+	return states;
+}
+
+void WriteBaselineSummary(const std::vector<ChannelState> &states, const std::string &base)
+{
+	std::ofstream fcsv(base + ".csv");
+	fcsv << "#ADC_Chan,Mean,Std,Sample_Mean,Sample_Std\n";
+	auto fsave = std::make_unique<TFile>((base + ".root").c_str(), "RECREATE");
+	auto gMean = std::make_unique<TGraphErrors>(states.size());
+	auto gRMS  = std::make_unique<TGraphErrors>(states.size());
+	std::vector<std::unique_ptr<TH1D>> histograms;
+	for(size_t entry = 0; entry < states.size(); entry++) {
+		const ChannelState &state = states[entry];
+		auto h = state.ToTH1(Form("hRun%d_ch%d", state.run, state.soft_chan), Form("ADC Chan %d; Chan %d [soft. chan]; Cts", state.adc_chan, state.soft_chan));
+		auto fitresult = h->Fit("gaus", "QS");
+		gMean->SetPoint(     entry, state.adc_chan, fitresult->Parameter(MEAN));
+		gMean->SetPointError(entry,              0, fitresult->ParError(MEAN) );
+		gRMS ->SetPoint(     entry, state.adc_chan, fitresult->Parameter(RMS) );
+		gRMS ->SetPointError(entry,              0, fitresult->ParError(RMS)  );
+		fcsv << state.adc_chan << "," << fitresult->Parameter(MEAN) << "," << fitresult->Parameter(RMS)
+		     << "," << h->GetMean() << "," << h->GetStdDev() << std::endl;
+		histograms.push_back(std::move(h));
+	}
+	gMean->SetTitle("Mean Vs ADC Chan; ADC Chan; Mean [V]");
+	gRMS ->SetTitle("RMS Vs ADC Chan; ADC Chan; RMS [V]");
+	gMean->Write("Mean");
+	gRMS ->Write("RMS");
+	auto dir_hists = fsave->mkdir("Histograms");
+	dir_hists->cd();
+	for( auto const &h : histograms ) h->Write(h->GetTitle());
+}
@@ -0,0 +1,32 @@
+#include "ChannelMap.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+ChannelMap::ChannelMap(std::vector<RunChannels> adc_chan)
+	: fAdcChan(std::move(adc_chan)), fSlot(fAdcChan.size())
+{
+	std::vector<int> &sorted = fSorted;
+	for( auto const &run : fAdcChan ) sorted.insert(sorted.end(), run.begin(), run.end());
+	std::sort(sorted.begin(), sorted.end());
+	const auto duplicate = std::adjacent_find(sorted.begin(), sorted.end());
+	if(duplicate != sorted.end()) {
+		throw std::invalid_argument("ChannelMap: ADC channel " + std::to_string(*duplicate) + " is mapped twice");
+	}
+	for(unsigned run = 0; run < fAdcChan.size(); run++) {
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+			fSlot[run][chan] = std::lower_bound(sorted.begin(), sorted.end(), fAdcChan[run][chan]) - sorted.begin();
+		}
+	}
+}
+
+ChannelMap ChannelMap::Descending(unsigned runs)
+{
+	std::vector<RunChannels> adc_chan(runs);
+	for(unsigned run = 0; run < runs; run++) {
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+			adc_chan[run][chan] = N_SOFT_CHAN*run + N_SOFT_CHAN - 1 - chan;
+		}
+	}
+	return ChannelMap(std::move(adc_chan));
+}
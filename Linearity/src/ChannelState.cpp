@@ -0,0 +1,126 @@
+#include "ChannelState.h"
+#include "CodeHistogram.h"
+#include "LinearFit.h"
+#include <TH1D.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+void ChannelState::Merge(const ChannelState &other)
+{
+	if(adc_chan < 0 || other.adc_chan < 0) {
+		throw std::invalid_argument("ChannelState::Merge: state without an ADC channel");
+	}
+	if(other.analysis != analysis || other.adc_chan != adc_chan) {
+		throw std::invalid_argument("ChannelState::Merge: states of different channels");
+	}
+	if(!counts.empty() && !other.counts.empty() && (other.adc_bits != adc_bits || std::abs(other.lsb - lsb) > 1e-9*std::abs(lsb))) {
+		throw std::invalid_argument("ChannelState::Merge: codes of different width");
+	}
+	if(files.empty()) {
+		*this = other;
+		return;
+	}
+	run = std::min(run, other.run);
+	files.insert(files.end(), other.files.begin(), other.files.end());
+
+	LinearFit fit = Fit();
+	fit.Merge(other.Fit());
+	SetFit(fit);
+
+	if(other.min < min) { min = other.min; min_tstmp = other.min_tstmp; }
+	if(other.max > max) { max = other.max; max_tstmp = other.max_tstmp; }
+
+	// Chan et al.
+	if(other.n > 0) {
+		const double na = n, nb = other.n, delta = other.mean - mean;
+		m2   += other.m2 + delta*delta*na*nb/(na + nb);
+		mean += delta*nb/(na + nb);
+		n    += other.n;
+	}
+
+	if(!other.counts.empty()) {
+		if(counts.empty()) {
+			adc_bits   = other.adc_bits;
+			lsb        = other.lsb;
+			first_code = other.first_code;
+			counts     = other.counts;
+		} else {
+			const std::int64_t lo = std::min(first_code, other.first_code);
+			const std::int64_t hi = std::max(first_code + (std::int64_t)counts.size(), other.first_code + (std::int64_t)other.counts.size());
+			std::vector<std::uint64_t> merged(hi - lo, 0);
+			for(size_t i = 0; i < counts.size(); i++)       merged[first_code + i - lo]       += counts[i];
+			for(size_t i = 0; i < other.counts.size(); i++) merged[other.first_code + i - lo] += other.counts[i];
+			first_code = lo;
+			counts     = std::move(merged);
+		}
+	}
+	underflow += other.underflow;
+	overflow  += other.overflow;
+}
+
+void ChannelState::SetFit(const LinearFit &fit)
+{
+	fit_n      = fit.N();
+	fit_mean_x = fit.MeanX();
+	fit_mean_y = fit.MeanY();
+	fit_cxx    = fit.Cxx();
+	fit_cyy    = fit.Cyy();
+	fit_cxy    = fit.Cxy();
+}
+
+LinearFit ChannelState::Fit() const
+{
+	return LinearFit(fit_n, fit_mean_x, fit_mean_y, fit_cxx, fit_cyy, fit_cxy);
+}
+
+void ChannelState::SetCodes(const CodeHistogram &codes, double code_lsb)
+{
+	adc_bits  = codes.Bits();
+	lsb       = code_lsb;
+	underflow = codes.Underflow();
+	overflow  = codes.Overflow();
+	counts.clear();
+	if(codes.Empty()) return;
+	first_code = codes.MinCode();
+	for(long code = codes.MinCode(); code <= codes.MaxCode(); code++) counts.push_back(codes.Counts(code));
+}
+
+CodeHistogram ChannelState::Codes() const
+{
+	CodeHistogram codes(adc_bits);
+	codes.Merge(first_code, counts, underflow, overflow);
+	return codes;
+}
+
+void ChannelState::SetHistogram(const TH1 &hist, double code_lsb)
+{
+	lsb = code_lsb;
+	counts.resize(hist.GetNbinsX());
+	for(size_t i = 0; i < counts.size(); i++) counts[i] = std::llround(hist.GetBinContent(i + 1));
+	first_code = std::llround(hist.GetBinCenter(1)/lsb);
+	underflow  = std::llround(hist.GetBinContent(0));
+	overflow   = std::llround(hist.GetBinContent(counts.size() + 1));
+
+	// sumw, sumw2, sumwx, sumwx2
+	double stats[4];
+	hist.GetStats(stats);
+	n    = std::llround(stats[0]);
+	mean = (stats[0] > 0) ? stats[2]/stats[0] : 0;
+	m2   = std::max(0.0, stats[3] - stats[0]*mean*mean);
+}
+
+std::unique_ptr<TH1D> ChannelState::ToTH1(const char* name, const char* title) const
+{
+	const double lo = (first_code - 0.5)*lsb;
+	auto hist = std::make_unique<TH1D>(name, title, std::max<size_t>(counts.size(), 1), lo, lo + std::max<size_t>(counts.size(), 1)*lsb);
+	hist->SetDirectory(nullptr);
+	for(size_t i = 0; i < counts.size(); i++) hist->SetBinContent(i + 1, counts[i]);
+	hist->SetBinContent(0, underflow);
+	hist->SetBinContent(counts.size() + 1, overflow);
+	// The exact moments, as LSBHistogramHelper leaves them
+	double stats[4] = {double(n), double(n), n*mean, m2 + n*mean*mean};
+	hist->PutStats(stats);
+	hist->SetEntries(n);
+	return hist;
+}
@@ -0,0 +1,161 @@
+#include "CodeHistogram.h"
+#include <TH1D.h>
+#include <TGraph.h>
+#include <TMath.h>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+static double MaxAbs(const std::vector<double> &v)
+{
+	double max = 0;
+	for(auto d : v) max = std::max(max, std::abs(d));
+	return max;
+}
+
+static std::unique_ptr<TGraph> CodeGraph(long first_code, const std::vector<double> &v)
+{
+	auto g = std::make_unique<TGraph>(v.size());
+	for(size_t index = 0; index < v.size(); index++) {
+		g->SetPoint(index, first_code + static_cast<long>(index), v[index]);
+	}
+	return g;
+}
+
+double CodeLinearity::MaxAbsDNL() const { return MaxAbs(dnl); }
+double CodeLinearity::MaxAbsINL() const { return MaxAbs(inl); }
+std::unique_ptr<TGraph> CodeLinearity::DNLGraph() const { return CodeGraph(first_code, dnl); }
+std::unique_ptr<TGraph> CodeLinearity::INLGraph() const { return CodeGraph(first_code, inl); }
+
+CodeHistogram::CodeHistogram(unsigned bits)
+	: fBits(bits), fOffset(1L << (bits-1)), fCounts((1UL << bits) + 1, 0)
+{
+}
+
+void CodeHistogram::FillVolts(const double* volts, size_t n, double inverse_lsb)
+{
+	for(size_t index = 0; index < n; index++) {
+		Fill(volts[index] * inverse_lsb);
+	}
+}
+
+void CodeHistogram::Merge(const CodeHistogram &other)
+{
+	if(other.fCounts.size() != fCounts.size()) throw std::invalid_argument("CodeHistogram::Merge: different ADC resolution");
+	std::transform(std::begin(fCounts), std::end(fCounts), std::begin(other.fCounts), std::begin(fCounts), std::plus<std::uint64_t>());
+	fUnderflow += other.fUnderflow;
+	fOverflow  += other.fOverflow;
+}
+
+void CodeHistogram::Merge(long first_code, const std::vector<std::uint64_t> &counts, std::uint64_t underflow, std::uint64_t overflow)
+{
+	for(size_t index = 0; index < counts.size(); index++) {
+		const long code = first_code + static_cast<long>(index);
+		if(code < LowerCode())      fUnderflow += counts[index];
+		else if(code > UpperCode()) fOverflow  += counts[index];
+		else                        fCounts[code + fOffset] += counts[index];
+	}
+	fUnderflow += underflow;
+	fOverflow  += overflow;
+}
+
+std::uint64_t CodeHistogram::Entries() const
+{
+	return std::accumulate(std::begin(fCounts), std::end(fCounts), std::uint64_t(0)) + fUnderflow + fOverflow;
+}
+
+bool CodeHistogram::Empty() const
+{
+	return std::all_of(std::begin(fCounts), std::end(fCounts), [](std::uint64_t c) { return c == 0; });
+}
+
+long CodeHistogram::MinCode() const
+{
+	auto first = std::find_if(std::begin(fCounts), std::end(fCounts), [](std::uint64_t c) { return c != 0; });
+	return std::distance(std::begin(fCounts), first) - fOffset;
+}
+
+long CodeHistogram::MaxCode() const
+{
+	auto last = std::find_if(std::rbegin(fCounts), std::rend(fCounts), [](std::uint64_t c) { return c != 0; });
+	return static_cast<long>(fCounts.size()) - 1 - std::distance(std::rbegin(fCounts), last) - fOffset;
+}
+
+// Narrows [first, last] to the codes with counts; false if nothing is left
+bool CodeHistogram::ClampToHits(long &first, long &last) const
+{
+	if(Empty()) return false;
+	first = std::max(first, MinCode());
+	last  = std::min(last,  MaxCode());
+	return first <= last;
+}
+
+CodeLinearity CodeHistogram::RampLinearity(long first, long last) const
+{
+	CodeLinearity result;
+	if(!ClampToHits(first, last)) return result;
+	result.first_code = first;
+
+	const size_t n = last - first + 1;
+	const std::uint64_t* counts = fCounts.data() + first + fOffset;
+	const std::uint64_t  total  = std::accumulate(counts, counts + n, std::uint64_t(0));
+	if(total == 0) return result;
+	result.mean_counts = double(total) / n;
+
+	result.dnl.resize(n);
+	result.inl.resize(n);
+	double inl = 0;
+	for(size_t index = 0; index < n; index++) {
+		result.dnl[index] = counts[index] / result.mean_counts - 1.0;
+		inl += result.dnl[index];
+		result.inl[index] = inl;
+	}
+	return result;
+}
+
+CodeLinearity CodeHistogram::SineLinearity(long first, long last) const
+{
+	CodeLinearity result;
+	if(!ClampToHits(first, last)) return result;
+	result.first_code = first;
+
+	// Cumulative counts over every code, so amplitude and offset drop out
+	const double total = Entries();
+	std::uint64_t cumulative = fUnderflow;
+	for(long code = LowerCode(); code < first; code++) cumulative += Counts(code);
+
+	const size_t n = last - first + 1;
+	std::vector<double> width(n);
+	double lower = -std::cos(TMath::Pi() * cumulative / total);
+	for(size_t index = 0; index < n; index++) {
+		cumulative += Counts(first + static_cast<long>(index));
+		const double upper = -std::cos(TMath::Pi() * cumulative / total);
+		width[index] = upper - lower;
+		lower = upper;
+	}
+	const double mean_width = std::accumulate(std::begin(width), std::end(width), 0.0) / n;
+	if(mean_width <= 0) return result;
+	result.mean_counts = double(std::accumulate(fCounts.data() + first + fOffset, fCounts.data() + last + fOffset + 1, std::uint64_t(0))) / n;
+
+	result.dnl.resize(n);
+	result.inl.resize(n);
+	double inl = 0;
+	for(size_t index = 0; index < n; index++) {
+		result.dnl[index] = width[index] / mean_width - 1.0;
+		inl += result.dnl[index];
+		result.inl[index] = inl;
+	}
+	return result;
+}
+
+std::unique_ptr<TH1D> CodeHistogram::ToTH1(const char* name, const char* title) const
+{
+	auto h = std::make_unique<TH1D>(name, title, fCounts.size(), LowerCode()-0.5, UpperCode()+0.5);
+	for(size_t bin = 0; bin < fCounts.size(); bin++) {
+		h->SetBinContent(bin+1, fCounts[bin]);
+	}
+	h->SetBinContent(0, fUnderflow);
+	h->SetBinContent(fCounts.size()+1, fOverflow);
+	h->SetEntries(Entries());
+	return h;
+}
@@ -0,0 +1,80 @@
+#include "CycleFit.h"
+#include "LinearFit.h"
+#include "Residual.h"
+#include <algorithm>
+#include <cmath>
+
+std::array<CycleFit, N_SOFT_CHAN> FitScannedCycle(const RampScanner &scanner, double offset)
+{
+	std::array<CycleFit, N_SOFT_CHAN> fits;
+	const auto& tStmp = scanner.TimeStamps();
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+		CycleFit &fit  = fits[chan];
+		fit.chan       = chan;
+		fit.extrema    = scanner.Extrema(chan);
+		const double t_first = std::min(fit.extrema.MinTimeStamp, fit.extrema.MaxTimeStamp);
+		const double t_last  = std::max(fit.extrema.MinTimeStamp, fit.extrema.MaxTimeStamp);
+
+		// The buffer is in tStmp order, so the fit window is an index range
+		const auto& ch_data = scanner.Samples(chan);
+		const size_t begin  = std::lower_bound(tStmp.begin(), tStmp.end(), t_first + offset) - tStmp.begin();
+		const size_t end    = std::upper_bound(tStmp.begin(), tStmp.end(), t_last  - offset) - tStmp.begin();
+		if(end <= begin) continue;
+
+		LinearFit line;
+		for(size_t index = begin; index < end; index++) line.Add(tStmp[index], ch_data[index]);
+		fit.n               = line.N();
+		fit.slope           = line.Slope();
+		fit.slope_error     = line.SlopeError();
+		fit.intercept       = line.Intercept();
+		fit.intercept_error = line.InterceptError();
+
+		const ResidualStats residual = LinearResidual(tStmp.data() + begin, ch_data.data() + begin, end - begin, fit.intercept, fit.slope);
+		fit.avg_residual = residual.mean;
+		fit.rms_residual = residual.rms;
+	}
+	return fits;
+}
+
+// Unweighted mean and spread, and inverse-variance weighted mean and its error
+static void Combine(const std::vector<double> &value, const std::vector<double> &error, double &mean, double &spread, double &weighted, double &weighted_error)
+{
+	double sum = 0, sum2 = 0, sum_w = 0, sum_wx = 0;
+	for(size_t i = 0; i < value.size(); i++) {
+		sum  += value[i];
+		sum2 += value[i]*value[i];
+		if(error[i] > 0) {
+			const double w = 1/(error[i]*error[i]);
+			sum_w  += w;
+			sum_wx += w*value[i];
+		}
+	}
+	const double n = value.size();
+	mean           = (n > 0) ? sum/n : 0;
+	spread         = (n > 1) ? std::sqrt(std::max(0.0, (sum2 - n*mean*mean)/(n - 1))) : 0;
+	weighted       = (sum_w > 0) ? sum_wx/sum_w : mean;
+	weighted_error = (sum_w > 0) ? 1/std::sqrt(sum_w) : 0;
+}
+
+CycleSummary Summarize(const std::vector<CycleFit> &fits)
+{
+	CycleSummary summary;
+	summary.cycles = fits.size();
+	if(fits.empty()) return summary;
+
+	std::vector<double> slope, slope_error, intercept, intercept_error;
+	LinearFit drift;
+	for( auto const &fit : fits ) {
+		slope.push_back(fit.slope);
+		slope_error.push_back(fit.slope_error);
+		intercept.push_back(fit.intercept);
+		intercept_error.push_back(fit.intercept_error);
+		summary.mean_rms_residual += fit.rms_residual / fits.size();
+		drift.Add(fit.start_tstmp, fit.slope);
+	}
+	Combine(slope, slope_error, summary.mean_slope, summary.slope_spread, summary.weighted_slope, summary.weighted_slope_error);
+	Combine(intercept, intercept_error, summary.mean_intercept, summary.intercept_spread, summary.weighted_intercept, summary.weighted_intercept_error);
+	summary.slope_drift       = drift.Slope();
+	summary.slope_drift_error = drift.SlopeError();
+	return summary;
+}
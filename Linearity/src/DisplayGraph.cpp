@@ -0,0 +1,76 @@
+#include "DisplayGraph.h"
+#include <TGraph.h>
+
+DisplayGraph::DisplayGraph(size_t max_points)
+	: fMaxBins(max_points/2)
+{
+	// Every bin gives up to two points
+	if(max_points > 0 && fMaxBins == 0) fMaxBins = 1;
+}
+
+void DisplayGraph::AddPoints(const double* x, const double* y, size_t n)
+{
+	for(size_t i = 0; i < n; i++) AddPoint(x[i], y[i]);
+}
+
+void DisplayGraph::Coarsen()
+{
+	while(fBins.size() > fMaxBins) {
+		if(fWidth > 0) {
+			fWidth *= 2;
+		}
+		else {
+			// Leaving the exact mode: aim for half of the bins
+			const double span = fBins.back().x_first - fOrigin;
+			fWidth = (span > 0) ? 2*span/fMaxBins : 1;
+		}
+
+		size_t kept = 0;
+		for(size_t i = 0; i < fBins.size(); i++) {
+			Bin bin = fBins[i];
+			bin.key = std::floor((bin.x_first - fOrigin)/fWidth);
+			if(kept > 0 && bin.key <= fBins[kept-1].key) {
+				fBins[kept-1].Merge(bin);
+			}
+			else {
+				fBins[kept++] = bin;
+			}
+		}
+		fBins.erase(fBins.begin() + kept, fBins.end());
+	}
+}
+
+size_t DisplayGraph::size() const
+{
+	size_t n = 0;
+	for( auto const &bin : fBins ) {
+		n += (bin.x_lo == bin.x_hi && bin.y_lo == bin.y_hi) ? 1 : 2;
+	}
+	return n;
+}
+
+void DisplayGraph::Fill(TGraph* graph) const
+{
+	graph->Set(size());
+	double* x = graph->GetX();
+	double* y = graph->GetY();
+	size_t point = 0;
+	for( auto const &bin : fBins ) {
+		// Keep the two points of a bin in x order
+		const bool lo_first = bin.x_lo <= bin.x_hi;
+		x[point] = lo_first ? bin.x_lo : bin.x_hi;
+		y[point] = lo_first ? bin.y_lo : bin.y_hi;
+		point++;
+		if(bin.x_lo == bin.x_hi && bin.y_lo == bin.y_hi) continue;
+		x[point] = lo_first ? bin.x_hi : bin.x_lo;
+		y[point] = lo_first ? bin.y_hi : bin.y_lo;
+		point++;
+	}
+}
+
+std::unique_ptr<TGraph> DisplayGraph::ToTGraph() const
+{
+	auto graph = std::make_unique<TGraph>();
+	Fill(graph.get());
+	return graph;
+}
@@ -0,0 +1,185 @@
+#include "Extrema.h"
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EXTREMA_X86 1
+#endif
+
+namespace {
+
+// Continues r over data[first,n); indices above anything in r, so strict
+// comparisons keep the first occurrence
+MinMaxIndex ScalarTail(const double* data, size_t first, size_t n, MinMaxIndex r)
+{
+	for(size_t index = first; index < n; index++) {
+		if(data[index] < r.min) {
+			r.min       = data[index];
+			r.min_index = index;
+		}
+		if(data[index] > r.max) {
+			r.max       = data[index];
+			r.max_index = index;
+		}
+	}
+	return r;
+}
+
+// Folds the per-lane results of a vector kernel, lowest index wins on ties.
+// Lanes that never matched carry the index -1.
+MinMaxIndex ReduceLanes(const double* vmin, const double* imin, const double* vmax, const double* imax, unsigned lanes)
+{
+	MinMaxIndex r;
+	for(unsigned lane = 0; lane < lanes; lane++) {
+		if(imin[lane] >= 0) {
+			const size_t index = imin[lane];
+			if(vmin[lane] < r.min || (vmin[lane] == r.min && index < r.min_index)) {
+				r.min       = vmin[lane];
+				r.min_index = index;
+			}
+		}
+		if(imax[lane] >= 0) {
+			const size_t index = imax[lane];
+			if(vmax[lane] > r.max || (vmax[lane] == r.max && index < r.max_index)) {
+				r.max       = vmax[lane];
+				r.max_index = index;
+			}
+		}
+	}
+	return r;
+}
+
+MinMaxIndex ScalarKernel(const double* data, size_t n)
+{
+	return ScalarTail(data, 0, n, MinMaxIndex{});
+}
+
+#ifdef EXTREMA_X86
+// Indices are carried as doubles, exact up to 2^53 samples
+__attribute__((target("avx2")))
+MinMaxIndex Avx2Kernel(const double* data, size_t n)
+{
+	constexpr unsigned LANES = 4;
+	if(n < LANES) return ScalarKernel(data, n);
+
+	__m256d vmin = _mm256_set1_pd(std::numeric_limits<double>::max());
+	__m256d vmax = _mm256_set1_pd(std::numeric_limits<double>::lowest());
+	__m256d imin = _mm256_set1_pd(-1);
+	__m256d imax = _mm256_set1_pd(-1);
+	__m256d idx  = _mm256_set_pd(3, 2, 1, 0);
+	const __m256d step = _mm256_set1_pd(LANES);
+
+	size_t index = 0;
+	for(; index + LANES <= n; index += LANES) {
+		const __m256d v  = _mm256_loadu_pd(data + index);
+		const __m256d lt = _mm256_cmp_pd(v, vmin, _CMP_LT_OQ);
+		const __m256d gt = _mm256_cmp_pd(v, vmax, _CMP_GT_OQ);
+		vmin = _mm256_blendv_pd(vmin, v,   lt);
+		imin = _mm256_blendv_pd(imin, idx, lt);
+		vmax = _mm256_blendv_pd(vmax, v,   gt);
+		imax = _mm256_blendv_pd(imax, idx, gt);
+		idx  = _mm256_add_pd(idx, step);
+	}
+
+	alignas(32) double lmin[LANES], lmax[LANES], limin[LANES], limax[LANES];
+	_mm256_store_pd(lmin,  vmin);
+	_mm256_store_pd(lmax,  vmax);
+	_mm256_store_pd(limin, imin);
+	_mm256_store_pd(limax, imax);
+	return ScalarTail(data, index, n, ReduceLanes(lmin, limin, lmax, limax, LANES));
+}
+
+__attribute__((target("avx512f")))
+MinMaxIndex Avx512Kernel(const double* data, size_t n)
+{
+	constexpr unsigned LANES = 8;
+	if(n < LANES) return ScalarKernel(data, n);
+
+	__m512d vmin = _mm512_set1_pd(std::numeric_limits<double>::max());
+	__m512d vmax = _mm512_set1_pd(std::numeric_limits<double>::lowest());
+	__m512d imin = _mm512_set1_pd(-1);
+	__m512d imax = _mm512_set1_pd(-1);
+	__m512d idx  = _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0);
+	const __m512d step = _mm512_set1_pd(LANES);
+
+	size_t index = 0;
+	for(; index + LANES <= n; index += LANES) {
+		const __m512d v  = _mm512_loadu_pd(data + index);
+		const __mmask8 lt = _mm512_cmp_pd_mask(v, vmin, _CMP_LT_OQ);
+		const __mmask8 gt = _mm512_cmp_pd_mask(v, vmax, _CMP_GT_OQ);
+		vmin = _mm512_mask_blend_pd(lt, vmin, v);
+		imin = _mm512_mask_blend_pd(lt, imin, idx);
+		vmax = _mm512_mask_blend_pd(gt, vmax, v);
+		imax = _mm512_mask_blend_pd(gt, imax, idx);
+		idx  = _mm512_add_pd(idx, step);
+	}
+
+	alignas(64) double lmin[LANES], lmax[LANES], limin[LANES], limax[LANES];
+	_mm512_store_pd(lmin,  vmin);
+	_mm512_store_pd(lmax,  vmax);
+	_mm512_store_pd(limin, imin);
+	_mm512_store_pd(limax, imax);
+	return ScalarTail(data, index, n, ReduceLanes(lmin, limin, lmax, limax, LANES));
+}
+#endif
+
+} // namespace
+
+bool ExtremaKernelSupported(EXTREMA_KERNEL kernel)
+{
+	switch(kernel) {
+		case EXTREMA_KERNEL::AUTO:
+		case EXTREMA_KERNEL::SCALAR:
+			return true;
+#ifdef EXTREMA_X86
+		case EXTREMA_KERNEL::AVX2:
+			return __builtin_cpu_supports("avx2");
+		case EXTREMA_KERNEL::AVX512:
+			return __builtin_cpu_supports("avx512f");
+#endif
+		default:
+			return false;
+	}
+}
+
+EXTREMA_KERNEL BestExtremaKernel()
+{
+	static const EXTREMA_KERNEL best = []() {
+		if(ExtremaKernelSupported(EXTREMA_KERNEL::AVX512)) return EXTREMA_KERNEL::AVX512;
+		if(ExtremaKernelSupported(EXTREMA_KERNEL::AVX2))   return EXTREMA_KERNEL::AVX2;
+		return EXTREMA_KERNEL::SCALAR;
+	}();
+	return best;
+}
+
+const char* ExtremaKernelName(EXTREMA_KERNEL kernel)
+{
+	switch(kernel) {
+		case EXTREMA_KERNEL::AUTO:   return "auto";
+		case EXTREMA_KERNEL::SCALAR: return "scalar";
+		case EXTREMA_KERNEL::AVX2:   return "avx2";
+		case EXTREMA_KERNEL::AVX512: return "avx512";
+	}
+	return "unknown";
+}
+
+MinMaxIndex FindMinMax(const double* data, size_t n, EXTREMA_KERNEL kernel)
+{
+	if(kernel == EXTREMA_KERNEL::AUTO) {
+		kernel = BestExtremaKernel();
+	} else if(!ExtremaKernelSupported(kernel)) {
+		throw std::runtime_error(std::string("FindMinMax: ") + ExtremaKernelName(kernel) + " kernel not supported by this CPU");
+	}
+
+	switch(kernel) {
+#ifdef EXTREMA_X86
+		case EXTREMA_KERNEL::AVX512:
+			return Avx512Kernel(data, n);
+		case EXTREMA_KERNEL::AVX2:
+			return Avx2Kernel(data, n);
+#endif
+		default:
+			return ScalarKernel(data, n);
+	}
+}
@@ -0,0 +1,136 @@
+#include "GateIndex.h"
+#include "SampleStream.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+
+static constexpr char          GATE_INDEX_MAGIC[4] = {'G','I','D','X'};
+static constexpr std::uint32_t GATE_INDEX_VERSION  = 2;  // 1: GateCycle written with its padding
+
+// Cycles are stored field by field, without the padding of GateCycle
+template<typename Stream, typename Field>
+static void Transfer(Stream &stream, Field &field)
+{
+	if constexpr(std::is_const_v<Field>) stream.write(reinterpret_cast<const char*>(&field), sizeof(field));
+	else                                 stream.read (reinterpret_cast<char*>(&field),       sizeof(field));
+}
+
+template<typename Stream, typename Cycle>
+static void TransferCycle(Stream &stream, Cycle &cycle)
+{
+	Transfer(stream, cycle.start_entry); Transfer(stream, cycle.start_index); Transfer(stream, cycle.start_tstmp);
+	Transfer(stream, cycle.end_entry);   Transfer(stream, cycle.end_index);   Transfer(stream, cycle.end_tstmp);
+	Transfer(stream, cycle.complete);
+}
+
+// Size and modification time of the source file, {0,0} if it does not exist
+static std::pair<std::uint64_t, std::int64_t> FileStamp(const std::string &file_name)
+{
+	std::error_code ec;
+	const auto size  = std::filesystem::file_size(file_name, ec);
+	if(ec) return {0, 0};
+	const auto mtime = std::filesystem::last_write_time(file_name, ec);
+	if(ec) return {0, 0};
+	return {size, mtime.time_since_epoch().count()};
+}
+
+GateIndex GateIndex::Build(ROOT::RNTupleReader* Reader, const std::string &file_name)
+{
+	GateIndex index;
+	std::tie(index.fSourceSize, index.fSourceMTime) = FileStamp(file_name);
+
+	SampleStreamView data(Reader, GATE1 | TSTMP);
+	bool      in_gate = false;
+	GateCycle cycle;
+	double    last_tstmp = 0;
+	for( auto entry : Reader->GetEntryRange() ) {
+		const auto& gate1 = data.gate1(entry);
+		const auto& tStmp = data.tStmp(entry);
+		for(size_t sample = 0; sample < gate1.size(); sample++) {
+			if(!in_gate && gate1[sample] != 0) {
+				in_gate = true;
+				cycle = GateCycle{};
+				cycle.start_entry = entry;
+				cycle.start_index = sample;
+				cycle.start_tstmp = tStmp[sample];
+			} else if(in_gate && gate1[sample] == 0) {
+				in_gate = false;
+				cycle.end_entry = entry;
+				cycle.end_index = sample;
+				cycle.end_tstmp = tStmp[sample];
+				cycle.complete  = 1;
+				index.fCycles.push_back(cycle);
+			}
+		}
+		if(!tStmp.empty()) last_tstmp = tStmp.back();
+	}
+	if(in_gate) {
+		cycle.end_entry = Reader->GetNEntries();
+		cycle.end_index = 0;
+		cycle.end_tstmp = last_tstmp;
+		index.fCycles.push_back(cycle);
+	}
+	return index;
+}
+
+bool GateIndex::Save(const std::string &file_name) const
+{
+	std::ofstream out(SidecarName(file_name), std::ios::binary | std::ios::trunc);
+	if(!out) return false;
+	const std::uint64_t n_cycles = fCycles.size();
+	out.write(GATE_INDEX_MAGIC, sizeof(GATE_INDEX_MAGIC));
+	out.write(reinterpret_cast<const char*>(&GATE_INDEX_VERSION), sizeof(GATE_INDEX_VERSION));
+	out.write(reinterpret_cast<const char*>(&fSourceSize),  sizeof(fSourceSize));
+	out.write(reinterpret_cast<const char*>(&fSourceMTime), sizeof(fSourceMTime));
+	out.write(reinterpret_cast<const char*>(&n_cycles),     sizeof(n_cycles));
+	for( auto const &cycle : fCycles ) TransferCycle(out, cycle);
+	return static_cast<bool>(out);
+}
+
+std::optional<GateIndex> GateIndex::Load(const std::string &file_name)
+{
+	std::ifstream in(SidecarName(file_name), std::ios::binary);
+	if(!in) return std::nullopt;
+
+	char          magic[sizeof(GATE_INDEX_MAGIC)];
+	std::uint32_t version  = 0;
+	std::uint64_t n_cycles = 0;
+	GateIndex     index;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(&version),            sizeof(version));
+	in.read(reinterpret_cast<char*>(&index.fSourceSize),  sizeof(index.fSourceSize));
+	in.read(reinterpret_cast<char*>(&index.fSourceMTime), sizeof(index.fSourceMTime));
+	in.read(reinterpret_cast<char*>(&n_cycles),           sizeof(n_cycles));
+	if(!in || !std::equal(std::begin(magic), std::end(magic), GATE_INDEX_MAGIC) || version != GATE_INDEX_VERSION) {
+		return std::nullopt;
+	}
+
+	// Stale once the run file has been rewritten
+	const auto stamp = FileStamp(file_name);
+	if(stamp.first != index.fSourceSize || stamp.second != index.fSourceMTime) return std::nullopt;
+
+	index.fCycles.resize(n_cycles);
+	for( auto &cycle : index.fCycles ) TransferCycle(in, cycle);
+	if(!in) return std::nullopt;
+	return index;
+}
+
+GateIndex GateIndex::LoadOrBuild(const std::string &file_name, ROOT::RNTupleReader* Reader)
+{
+	if(auto index = Load(file_name)) return *index;
+
+	std::unique_ptr<ROOT::RNTupleReader> owned;
+	if(Reader == nullptr) {
+		owned  = ROOT::RNTupleReader::Open("DataTree", file_name);
+		Reader = owned.get();
+	}
+	GateIndex index = Build(Reader, file_name);
+	if(!index.Save(file_name)) {
+		std::cerr << "GateIndex: could not write " << SidecarName(file_name) << ", index is not cached\n";
+	}
+	return index;
+}
@@ -0,0 +1,61 @@
+#include "LinearFit.h"
+#include <TF1.h>
+#include <cmath>
+#include <algorithm>
+
+void LinearFit::Merge(const LinearFit &other)
+{
+	if(other.fN == 0) return;
+	if(fN == 0) {
+		*this = other;
+		return;
+	}
+	const double na = fN, nb = other.fN, n = na + nb;
+	const double dx = other.fMeanX - fMeanX;
+	const double dy = other.fMeanY - fMeanY;
+	fCxx   += other.fCxx + dx*dx*na*nb/n;
+	fCyy   += other.fCyy + dy*dy*na*nb/n;
+	fCxy   += other.fCxy + dx*dy*na*nb/n;
+	fMeanX += dx*nb/n;
+	fMeanY += dy*nb/n;
+	fN     += other.fN;
+}
+
+double LinearFit::Slope() const
+{
+	return (fCxx > 0) ? fCxy / fCxx : 0;
+}
+
+double LinearFit::Intercept() const
+{
+	return fMeanY - Slope()*fMeanX;
+}
+
+double LinearFit::Chi2() const
+{
+	if(fCxx <= 0) return fCyy;
+	return std::max(0.0, fCyy - fCxy*fCxy/fCxx);
+}
+
+double LinearFit::SlopeError() const
+{
+	if(NDF() == 0 || fCxx <= 0) return 0;
+	return std::sqrt( Chi2()/NDF() / fCxx );
+}
+
+double LinearFit::InterceptError() const
+{
+	if(NDF() == 0 || fCxx <= 0) return 0;
+	return std::sqrt( Chi2()/NDF() * (1.0/fN + fMeanX*fMeanX/fCxx) );
+}
+
+void LinearFit::Apply(TF1* fit) const
+{
+	fit->SetParameter(0, Intercept());
+	fit->SetParError (0, InterceptError());
+	fit->SetParameter(1, Slope());
+	fit->SetParError (1, SlopeError());
+	fit->SetChisquare(Chi2());
+	fit->SetNDF(NDF());
+	fit->SetNumberFitPoints(fN);
+}
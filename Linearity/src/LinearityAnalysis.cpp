@@ -0,0 +1,293 @@
+#include "LinearityAnalysis.h"
+#include "Residual.h"
+#include <TF1.h>
+#include <TGraph.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <tuple>
+
+Signal_tStmp Find_Valid_Signal_Range(const ChannelExtrema &extrema)
+{
+	auto MaxTimeStamp = extrema.MaxTimeStamp;
+	auto MinTimeStamp = extrema.MinTimeStamp;
+	return (MinTimeStamp < MaxTimeStamp) ? Signal_tStmp{MinTimeStamp, MaxTimeStamp} : Signal_tStmp{MaxTimeStamp, MinTimeStamp};
+}
+
+RampScanner ScanRun(const std::string &file_name, const LinearitySettings &settings, StageReport* report, std::vector<CycleFit>* cycles)
+{
+	std::unique_ptr<ROOT::RNTupleReader> Reader = ROOT::RNTupleReader::Open("DataTree",file_name.c_str());
+	RampScanner scanner;
+	// Timed on its own and before the scan, so no time is charged to both stages
+	GateIndex index;
+	if(settings.use_index || cycles != nullptr) {
+		auto index_timer = report->Stage("gate index");
+		index = settings.use_index ? GateIndex::LoadOrBuild(file_name, Reader.get()) : GateIndex::Build(Reader.get(), file_name);
+	}
+	auto scan_timer = report->Stage("scan");
+	if(index.size() > 1 && cycles != nullptr) {
+		// One pass from the second cycle to the end of the run feeds the run and every cycle fit
+		ReadAhead stream(file_name, ALL_COLUMNS, scanner.CycleRange(Reader.get(), index, 1), settings.read_ahead);
+		RampScanner follower;
+		size_t cycle = 1;
+		follower.ScanCycles(stream, index, cycle, [&](const RampScanner &cycle_scanner) {
+			if(cycle == 1) scanner = cycle_scanner;
+			for( auto fit : FitScannedCycle(cycle_scanner, settings.offset) ) {
+				if(fit.n == 0) continue;
+				fit.cycle       = cycle;
+				fit.start_tstmp = cycle_scanner.GateOpenTimeStamp();
+				cycles->push_back(fit);
+			}
+			cycle++;
+		});
+		// The run ended inside its second cycle
+		if(cycle == 1) scanner = follower;
+		scan_timer.CPU(stream.ProducerCPU());
+		scan_timer.Entries(follower.Read().entries).Samples(follower.Read().samples).Bytes(follower.Read().bytes);
+		return scanner;
+	}
+	if(index.size() > 1) {
+		// Jump straight to the second cycle
+		if(settings.read_ahead > 0) {
+			ReadAhead stream(file_name, ALL_COLUMNS, scanner.CycleRange(Reader.get(), index, 1), settings.read_ahead);
+			scanner.Scan(stream, index, 1);
+			scan_timer.CPU(stream.ProducerCPU());
+		}
+		else {
+			scanner.Scan(Reader.get(), index, 1);
+		}
+		scan_timer.Entries(scanner.Read().entries).Samples(scanner.Read().samples).Bytes(scanner.Read().bytes);
+		return scanner;
+	}
+	scanner.Scan(Reader.get());
+	scan_timer.Entries(scanner.Read().entries).Samples(scanner.Read().samples).Bytes(scanner.Read().bytes);
+	return scanner;
+}
+
+ChannelResult AnalyzeChannel(const RampScanner &scanner, SOFTWARE_CHANNEL chan, int adc_channel, const LinearitySettings &settings,
+                             TGraph* gRange, TGraph* gResidual, StageReport* report)
+{
+	const double offset = settings.offset;
+	ChannelResult result;
+	result.adc_channel = adc_channel;
+	result.chan        = chan;
+	result.extrema     = scanner.Extrema(chan);
+	const Signal_tStmp extrema = Find_Valid_Signal_Range(result.extrema);
+
+	// Draw +-10% to check
+	DisplayGraph range_display(settings.max_points);
+	LinearFit linear_fit;
+	const auto& ch_data  = scanner.Samples(chan);
+	const auto& tStmp    = scanner.TimeStamps();
+	auto fill_timer = report->Stage("fill", adc_channel);
+	fill_timer.Samples(ch_data.size()).Bytes(ch_data.size()*2*sizeof(double));
+	for(size_t index = 0; index < ch_data.size(); index++) {
+		if(tStmp[index] >= extrema.min-10 && tStmp[index] <= extrema.max+10) {
+			if(gRange != nullptr) range_display.AddPoint(tStmp[index], ch_data[index]);
+			if(tStmp[index] >= extrema.min+offset && tStmp[index] <= extrema.max-offset) {
+				linear_fit.Add( tStmp[index], ch_data[index] );
+			}
+		}
+	}
+	if(gRange != nullptr) {
+		range_display.Fill(gRange);
+		gRange->SetTitle(Form("Soft. Chan %d vs Time; tStmp [ms]; ch%d_data",chan, chan));
+		fill_timer.Points(gRange->GetN());
+	}
+	fill_timer.Stop();
+
+	// Fit with the exact range we care about; the points were accumulated above
+	auto fit_timer = report->Stage("fit", adc_channel);
+	fit_timer.Samples(linear_fit.N());
+	result.n = linear_fit.N();
+	auto fit = std::make_unique<TF1>(Form("fit_adc_chan%d", adc_channel), "pol1", extrema.min+offset, extrema.max-offset);
+	linear_fit.Apply(fit.get());
+	result.slope           = fit->GetParameter(1);
+	result.slope_error     = fit->GetParError(1);
+	result.intercept       = fit->GetParameter(0);
+	result.intercept_error = fit->GetParError(0);
+	result.fit             = linear_fit;
+	if(gRange != nullptr) gRange->GetListOfFunctions()->Add(fit.release());
+	fit_timer.Stop();
+
+	// Compute Residual over the fit window; the buffer is in tStmp order
+	const size_t window_begin = std::lower_bound(tStmp.begin(), tStmp.end(), extrema.min+offset) - tStmp.begin();
+	const size_t window_end   = std::upper_bound(tStmp.begin(), tStmp.end(), extrema.max-offset) - tStmp.begin();
+	const size_t window_size  = (window_end > window_begin) ? window_end - window_begin : 0;
+	auto residual_timer = report->Stage("residual", adc_channel);
+	residual_timer.Samples(window_size).Bytes(window_size*2*sizeof(double));
+	DisplayGraph residual_display(settings.max_points);
+	const ResidualStats residual = LinearResidual(tStmp.data() + window_begin, ch_data.data() + window_begin, window_size,
+	                                              result.intercept, result.slope, nullptr, (gResidual != nullptr) ? &residual_display : nullptr);
+	result.avg_residual = residual.mean;
+	result.rms_residual = residual.rms;
+	if(gResidual != nullptr) {
+		residual_display.Fill(gResidual);
+		gResidual->SetTitle(Form("Residual Vs ADC Chan%d; ADC Chan %d; Residual", adc_channel,adc_channel));
+		residual_timer.Points(gResidual->GetN());
+	}
+
+	return result;
+}
+
+void WriteCyclesCSV(const std::string &file_name, const std::vector<CycleFit> &fits, const ChannelMap &channel_map)
+{
+	std::ofstream fcsv(file_name);
+	fcsv << "#run,cycle,adc_chan,soft_chan,start_tstmp,n,slope,slope_error,intercept,intercept_error,avg_residual,rms_residual\n";
+	fcsv << std::setprecision(10);
+	for( auto const &fit : fits ) {
+		fcsv << fit.run << "," << fit.cycle << "," << channel_map.AdcChannel(fit.run, fit.chan) << "," << fit.chan << "," << fit.start_tstmp << "," << fit.n << ","
+		     << fit.slope << "," << fit.slope_error << "," << fit.intercept << "," << fit.intercept_error << ","
+		     << fit.avg_residual << "," << fit.rms_residual << "\n";
+	}
+}
+
+FitRecord Record(const ChannelResult &result, const std::string &file)
+{
+	FitRecord record;
+	record.file            = file;
+	record.run             = result.run;
+	record.soft_chan       = result.chan;
+	record.adc_chan        = result.adc_channel;
+	record.n               = result.n;
+	record.slope           = result.slope;
+	record.slope_error     = result.slope_error;
+	record.intercept       = result.intercept;
+	record.intercept_error = result.intercept_error;
+	record.avg_residual    = result.avg_residual;
+	record.rms_residual    = result.rms_residual;
+	record.min             = result.extrema.min;
+	record.min_tstmp       = result.extrema.MinTimeStamp;
+	record.max             = result.extrema.max;
+	record.max_tstmp       = result.extrema.MaxTimeStamp;
+	return record;
+}
+
+ChannelState State(const ChannelResult &result, const std::string &file)
+{
+	ChannelState state;
+	state.analysis  = (std::int32_t)STATE_ANALYSIS::LINEARITY;
+	state.adc_chan  = result.adc_channel;
+	state.soft_chan = result.chan;
+	state.run       = result.run;
+	state.files     = {file};
+	state.SetFit(result.fit);
+	state.min       = result.extrema.min;
+	state.min_tstmp = result.extrema.MinTimeStamp;
+	state.max       = result.extrema.max;
+	state.max_tstmp = result.extrema.MaxTimeStamp;
+	return state;
+}
+
+FitRecord Record(const CycleFit &fit, const std::string &file, int adc_channel)
+{
+	FitRecord record;
+	record.file            = file;
+	record.run             = fit.run;
+	record.cycle           = fit.cycle;
+	record.soft_chan       = fit.chan;
+	record.adc_chan        = adc_channel;
+	record.start_tstmp     = fit.start_tstmp;
+	record.n               = fit.n;
+	record.slope           = fit.slope;
+	record.slope_error     = fit.slope_error;
+	record.intercept       = fit.intercept;
+	record.intercept_error = fit.intercept_error;
+	record.avg_residual    = fit.avg_residual;
+	record.rms_residual    = fit.rms_residual;
+	record.min             = fit.extrema.min;
+	record.min_tstmp       = fit.extrema.MinTimeStamp;
+	record.max             = fit.extrema.max;
+	record.max_tstmp       = fit.extrema.MaxTimeStamp;
+	return record;
+}
+
+std::string LinearityCacheConfig(const LinearitySettings &settings)
+{
+	return Form("linearity offset=%g index=%d all_cycles=%d", settings.offset, settings.use_index, settings.all_cycles);
+}
+
+// Results of one channel from its cache entry, the inverse of Record() and State().
+// False if the entry misses the per-run fit, e.g. written by another program.
+static bool Restore(const CachedChannel &cached, ChannelResult &result, std::vector<CycleFit> &cycles)
+{
+	const auto per_run = std::find_if(cached.records.begin(), cached.records.end(), [](const FitRecord &record) { return record.cycle < 0; });
+	if(per_run == cached.records.end() || cached.states.size() != 1) return false;
+	result.adc_channel          = per_run->adc_chan;
+	result.run                  = per_run->run;
+	result.n                    = per_run->n;
+	result.chan                 = (SOFTWARE_CHANNEL)per_run->soft_chan;
+	result.extrema.min          = per_run->min;
+	result.extrema.MinTimeStamp = per_run->min_tstmp;
+	result.extrema.max          = per_run->max;
+	result.extrema.MaxTimeStamp = per_run->max_tstmp;
+	result.slope                = per_run->slope;
+	result.slope_error          = per_run->slope_error;
+	result.intercept            = per_run->intercept;
+	result.intercept_error      = per_run->intercept_error;
+	result.avg_residual         = per_run->avg_residual;
+	result.rms_residual         = per_run->rms_residual;
+	result.fit                  = cached.states.front().Fit();
+	for( auto const &record : cached.records ) {
+		if(record.cycle < 0) continue;
+		CycleFit fit;
+		fit.run                  = record.run;
+		fit.cycle                = record.cycle;
+		fit.chan                 = record.soft_chan;
+		fit.start_tstmp          = record.start_tstmp;
+		fit.extrema.min          = record.min;
+		fit.extrema.MinTimeStamp = record.min_tstmp;
+		fit.extrema.max          = record.max;
+		fit.extrema.MaxTimeStamp = record.max_tstmp;
+		fit.n                    = record.n;
+		fit.slope                = record.slope;
+		fit.slope_error          = record.slope_error;
+		fit.intercept            = record.intercept;
+		fit.intercept_error      = record.intercept_error;
+		fit.avg_residual         = record.avg_residual;
+		fit.rms_residual         = record.rms_residual;
+		cycles.push_back(fit);
+	}
+	return true;
+}
+
+bool LookupRun(const ResultCache &cache, const std::string &file, unsigned run, const ChannelMap &channel_map, const std::string &config,
+               bool lookup, PerChannel<std::string> &keys, std::vector<ChannelResult> &results, std::vector<CycleFit> &cycles)
+{
+	keys = {};
+	if(!cache.Enabled()) return false;
+	const SourceIdentity source = SourceIdentity::Of(file);
+	if(source.size == 0) return false;
+	std::vector<ChannelResult> hits;
+	std::vector<CycleFit>      hit_cycles;
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+		keys[chan] = cache.Key(source, chan, channel_map.AdcChannel(run, chan), config);
+		if(!lookup) continue;
+		const auto cached = cache.Load(keys[chan]);
+		ChannelResult result;
+		if(cached && Restore(*cached, result, hit_cycles)) {
+			result.run  = run;
+			result.slot = channel_map.Slot(run, chan);
+			hits.push_back(result);
+		}
+	}
+	if(hits.size() != N_SOFT_CHAN) return false;
+	// The run indices of the entry may be from a different run list
+	for( auto &fit : hit_cycles ) fit.run = run;
+	results.insert(results.end(), hits.begin(), hits.end());
+	cycles.insert(cycles.end(), hit_cycles.begin(), hit_cycles.end());
+	return true;
+}
+
+bool StoreChannel(const ResultCache &cache, const std::string &key, const ChannelResult &result, const std::vector<CycleFit> &cycles,
+                  const std::string &file)
+{
+	CachedChannel entry;
+	entry.records.push_back(Record(result, file));
+	entry.states.push_back(State(result, file));
+	for( auto const &fit : cycles ) {
+		if(fit.run == result.run && fit.chan == (unsigned)result.chan) entry.records.push_back(Record(fit, file, result.adc_channel));
+	}
+	return cache.Store(key, entry);
+}
@@ -0,0 +1,275 @@
+#include "RampScanner.h"
+#include <algorithm>
+#include <cmath>
+
+RampScanner::RampScanner(double guard)
+	: fGuard(guard)
+{
+}
+
+void RampScanner::Trim(double oldest)
+{
+	auto first = std::lower_bound(std::begin(fTimeStamps), std::end(fTimeStamps), oldest);
+	auto count = std::distance(std::begin(fTimeStamps), first);
+	if(count == 0) return;
+	fTimeStamps.erase(std::begin(fTimeStamps), first);
+	for(auto &samples : fSamples) {
+		samples.erase(std::begin(samples), std::begin(samples) + count);
+	}
+}
+
+void RampScanner::Reset()
+{
+	fSkipped            = false;
+	fState              = STATE::SEEK_FIRST_CYCLE;
+	fLastGatedTimeStamp = 0;
+	fGateOpenTimeStamp  = 0;
+	fNotBefore          = std::numeric_limits<double>::lowest();
+	fExtrema.fill(ChannelExtrema());
+	fTimeStamps.clear();
+	for(auto &samples : fSamples) samples.clear();
+	fRead = StageCounters();
+}
+
+void RampScanner::NextCycle()
+{
+	// The gate closed after the last gated sample, so the next opening is later
+	const double not_before = std::nextafter(fLastGatedTimeStamp, std::numeric_limits<double>::max());
+	Reset();
+	fState     = STATE::SEEK_SECOND_CYCLE;
+	fNotBefore = not_before;
+}
+
+void RampScanner::Reserve(size_t samples)
+{
+	fTimeStamps.reserve(samples);
+	for(auto &buffer : fSamples) buffer.reserve(samples);
+}
+
+void RampScanner::ReserveCycle(const GateCycle &cycle, const EntrySpans &first)
+{
+	const size_t length = first.tStmp.size();
+	if(length < 2 || cycle.end_entry < cycle.start_entry) return;
+	const double spacing = (double)first.tStmp[1] - first.tStmp[0];
+	// Gated samples, the guard window on either side and a partial entry at each end
+	size_t samples = (cycle.end_entry - cycle.start_entry)*length + cycle.end_index - cycle.start_index + 2*length;
+	if(spacing > 0) samples += 2*static_cast<size_t>(fGuard/spacing + 1);
+	Reserve(samples);
+}
+
+bool RampScanner::Process(const gate_vector_t &gate1, const tStmp_vector_t &tStmp, const ChannelSet &ch_data)
+{
+	EntrySpans entry;
+	entry.gate1 = gate1;
+	entry.tStmp = tStmp;
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) entry.ch_data[chan] = *ch_data[chan];
+	return Process(entry);
+}
+
+bool RampScanner::Process(const EntrySpans &entry)
+{
+	if(fState == STATE::DONE) return false;
+	const auto& gate1 = entry.gate1;
+	const auto& tStmp = entry.tStmp;
+
+	// Walk the entry span by span between gate edges
+	const size_t n = gate1.size();
+	size_t index = 0, keep = n;
+	bool   opened = false;
+	double gate_open_tstmp = 0;
+	while(index < n) {
+		switch(fState) {
+			case STATE::SEEK_FIRST_CYCLE:
+				while(index < n && gate1[index] == 0) index++;
+				if(index < n) fState = STATE::IN_FIRST_CYCLE;
+				break;
+			case STATE::IN_FIRST_CYCLE:
+				while(index < n && gate1[index] != 0) index++;
+				if(index < n) fState = STATE::SEEK_SECOND_CYCLE;
+				break;
+			case STATE::SEEK_SECOND_CYCLE:
+				while(index < n && (gate1[index] == 0 || tStmp[index] < fNotBefore)) index++;
+				if(index < n) {
+					fState = STATE::IN_SECOND_CYCLE;
+					opened = true;
+					gate_open_tstmp = tStmp[index];
+					fGateOpenTimeStamp = gate_open_tstmp;
+				}
+				break;
+			case STATE::IN_SECOND_CYCLE: {
+				size_t last = index;
+				while(last < n && gate1[last] != 0) last++;
+				if(last > index) {
+					for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+						UpdateExtrema(fExtrema[chan], entry.ch_data[chan].data()+index, tStmp.data()+index, last-index);
+					}
+					fLastGatedTimeStamp = tStmp[last-1];
+				}
+				index = last;
+				if(index < n) fState = STATE::TRAILING;
+				break;
+			}
+			case STATE::TRAILING:
+				while(index < n && tStmp[index] <= fLastGatedTimeStamp + fGuard) index++;
+				if(index < n) {
+					fState = STATE::DONE;
+					keep   = index;
+					index  = n;
+				}
+				break;
+			case STATE::DONE:
+				index = n;
+				break;
+		}
+	}
+
+	fTimeStamps.insert(std::end(fTimeStamps), tStmp.begin(), tStmp.begin() + keep);
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+		fSamples[chan].insert(std::end(fSamples[chan]), entry.ch_data[chan].begin(), entry.ch_data[chan].begin() + keep);
+	}
+
+	// Until the second gate opens only the trailing guard window is worth keeping,
+	// nothing older than the guard window before the gate can be in range
+	if(opened) {
+		Trim(gate_open_tstmp - fGuard);
+	} else if(fState < STATE::IN_SECOND_CYCLE && !fTimeStamps.empty()) {
+		Trim(fTimeStamps.back() - fGuard);
+	}
+	return fState != STATE::DONE;
+}
+
+bool RampScanner::Skip(const gate_vector_t &gate1)
+{
+	if(fState > STATE::IN_FIRST_CYCLE) return false;
+
+	STATE state = fState;
+	for(const auto g : gate1) {
+		if(state == STATE::SEEK_FIRST_CYCLE) {
+			if(g != 0) state = STATE::IN_FIRST_CYCLE;
+		} else if(g == 0) {
+			return false;
+		}
+	}
+	fState   = state;
+	fSkipped = true;
+	return true;
+}
+
+void RampScanner::Backfill(const EntrySpans &entry, double oldest)
+{
+	// tStmp increases, so the samples to keep are the tail of the entry
+	const auto first = std::lower_bound(entry.tStmp.begin(), entry.tStmp.end(), oldest) - entry.tStmp.begin();
+	fTimeStamps.insert(std::end(fTimeStamps), entry.tStmp.begin() + first, entry.tStmp.end());
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+		fSamples[chan].insert(std::end(fSamples[chan]), entry.ch_data[chan].begin() + first, entry.ch_data[chan].end());
+	}
+}
+
+bool RampScanner::Process(const tDataSamples &entry)
+{
+	return Process(Spans(entry));
+}
+
+void RampScanner::CountSamples(size_t n)
+{
+	fRead.samples += n;
+	fRead.bytes   += n*(sizeof(tStmp_vector_t::value_type) + N_SOFT_CHAN*sizeof(data_vector_t::value_type));
+}
+
+void RampScanner::Scan(ROOT::RNTupleReader* Reader)
+{
+	SampleStreamView data(Reader, ALL_COLUMNS);
+
+	const auto range = Reader->GetEntryRange();
+	for( auto entry : range ) {
+		// The first cycle only needs the gate
+		const auto& gate1 = data.gate1(entry);
+		// gate1 is the storage of the view, which the backfill below reloads with earlier entries
+		const size_t n = gate1.size();
+		fRead.entries++;
+		fRead.bytes += n*sizeof(gate_vector_t::value_type);
+		if(Skip(gate1)) continue;
+
+		if(fSkipped) {
+			// Pick up the tail of the skipped entries that may lie within the guard window
+			const double oldest = data.tStmp(entry).front() - fGuard;
+			auto first = entry;
+			while(first > *range.begin() && data.tStmp(first-1).back() >= oldest) first--;
+			for(auto skipped = first; skipped < entry; skipped++) {
+				Backfill(data.spans(skipped), oldest);
+				CountSamples(data.tStmp(skipped).size());
+			}
+			fSkipped = false;
+		}
+
+		CountSamples(n);
+		if(Process(data.spans(entry)) == false) break;
+	}
+}
+
+void RampScanner::StartAt(const GateIndex &index, size_t cycle)
+{
+	// Everything before the cycle opens counts as being past the first cycle
+	fState     = STATE::SEEK_SECOND_CYCLE;
+	fNotBefore = index[cycle].start_tstmp;
+}
+
+ROOT::RNTupleGlobalRange RampScanner::CycleRange(ROOT::RNTupleReader* Reader, const GateIndex &index, size_t cycle) const
+{
+	return SeekTimeRange(Reader, index[cycle].start_tstmp - fGuard);
+}
+
+void RampScanner::Scan(ROOT::RNTupleReader* Reader, const GateIndex &index, size_t cycle)
+{
+	StartAt(index, cycle);
+	SampleStreamView data(Reader, ALL_COLUMNS);
+	bool first = true;
+	for( auto entry : CycleRange(Reader, index, cycle) ) {
+		const EntrySpans spans = data.spans(entry);
+		if(first) ReserveCycle(index[cycle], spans);
+		first = false;
+		fRead.entries++;
+		fRead.bytes += spans.gate1.size()*sizeof(gate_vector_t::value_type);
+		CountSamples(spans.gate1.size());
+		if(Process(spans) == false) break;
+	}
+}
+
+void RampScanner::Scan(ReadAhead &stream, const GateIndex &index, size_t cycle)
+{
+	StartAt(index, cycle);
+	bool first = true;
+	while(const EntryBuffer* buffer = stream.Next()) {
+		if(first) ReserveCycle(index[cycle], buffer->spans);
+		first = false;
+		fRead.entries++;
+		fRead.bytes += buffer->spans.gate1.size()*sizeof(gate_vector_t::value_type);
+		CountSamples(buffer->spans.gate1.size());
+		if(Process(buffer->spans) == false) break;
+	}
+	// The producer would otherwise decode the rest of the run
+	stream.Stop();
+}
+
+void RampScanner::ScanCycles(ReadAhead &stream, const GateIndex &index, size_t cycle, const std::function<void(const RampScanner&)> &on_cycle)
+{
+	StartAt(index, cycle);
+	bool first = true;
+	while(const EntryBuffer* buffer = stream.Next()) {
+		if(first) ReserveCycle(index[cycle], buffer->spans);
+		first = false;
+		fRead.entries++;
+		fRead.bytes += buffer->spans.gate1.size()*sizeof(gate_vector_t::value_type);
+		CountSamples(buffer->spans.gate1.size());
+		// The entry that finished a cycle may already open the next one
+		while(Process(buffer->spans) == false) {
+			on_cycle(*this);
+			// NextCycle() starts the counters over
+			const StageCounters read = fRead;
+			NextCycle();
+			fRead = read;
+		}
+	}
+	// The run may end inside the guard window of the last cycle
+	if(RangeFound()) on_cycle(*this);
+}
@@ -0,0 +1,115 @@
+#include "ReadAhead.h"
+#include "StageTimer.h"
+#include <TROOT.h>
+#include <utility>
+
+static constexpr size_t NO_BUFFER = static_cast<size_t>(-1);
+
+ReadAhead::ReadAhead(const std::string &file_name, unsigned columns, ROOT::RNTupleGlobalRange range, size_t depth)
+	: fFileName(file_name), fColumns(columns), fDepth(depth), fFirst(*range.begin()), fNext(fFirst), fEnd(*range.end()),
+	  fBuffers(depth ? depth : 1), fCurrent(NO_BUFFER)
+{
+	if(fDepth == 0) {
+		Open();
+		return;
+	}
+	// The producer reads the file while the caller may use its own readers; idempotent
+	ROOT::EnableThreadSafety();
+	for(size_t index = 0; index < fBuffers.size(); index++) fFree.push_back(index);
+	fProducer = std::thread(&ReadAhead::Produce, this);
+}
+
+ReadAhead::~ReadAhead()
+{
+	Stop();
+	if(fProducer.joinable()) fProducer.join();
+}
+
+void ReadAhead::Open()
+{
+	fReader = ROOT::RNTupleReader::Open("DataTree", fFileName);
+	fData   = std::make_unique<SampleStreamView>(fReader.get(), fColumns);
+}
+
+// The pages are unpacked into the vectors of the buffer itself, which RNTuple
+// resizes in place, so their capacity carries over from earlier entries
+void ReadAhead::Decode(ROOT::NTupleSize_t entry, EntryBuffer &buffer)
+{
+	buffer.entry = entry;
+	buffer.spans = fData->ReadInto(entry, buffer.gate1, buffer.tStmp, buffer.ch_data);
+}
+
+void ReadAhead::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(fMutex);
+		fStop = true;
+	}
+	fFreeCV.notify_all();
+}
+
+double ReadAhead::ProducerCPU()
+{
+	Stop();
+	if(fProducer.joinable()) fProducer.join();
+	return fProducerCPU;
+}
+
+void ReadAhead::Produce()
+{
+	const double cpu_start = StageReport::CPUTime(CPU_CLOCK::THREAD);
+	try {
+		Open();
+		for(; fNext < fEnd; fNext++) {
+			size_t slot;
+			{
+				std::unique_lock<std::mutex> lock(fMutex);
+				fFreeCV.wait(lock, [this] { return fStop || !fFree.empty(); });
+				if(fStop) break;
+				slot = fFree.front();
+				fFree.pop_front();
+			}
+			// Decode outside of the lock, the consumer keeps working on its buffer
+			Decode(fNext, fBuffers[slot]);
+			{
+				std::lock_guard<std::mutex> lock(fMutex);
+				fFilled.push_back(slot);
+			}
+			fFilledCV.notify_one();
+		}
+	}
+	catch(...) {
+		std::lock_guard<std::mutex> lock(fMutex);
+		fError = std::current_exception();
+	}
+	{
+		std::lock_guard<std::mutex> lock(fMutex);
+		fProducerDone = true;
+		fProducerCPU  = StageReport::CPUTime(CPU_CLOCK::THREAD) - cpu_start;
+	}
+	fFilledCV.notify_all();
+}
+
+const EntryBuffer* ReadAhead::Next()
+{
+	if(fDepth == 0) {
+		if(fStop || fNext >= fEnd) return nullptr;
+		Decode(fNext++, fBuffers[0]);
+		return &fBuffers[0];
+	}
+
+	std::unique_lock<std::mutex> lock(fMutex);
+	if(fCurrent != NO_BUFFER) {
+		fFree.push_back(fCurrent);
+		fCurrent = NO_BUFFER;
+		fFreeCV.notify_one();
+	}
+	fFilledCV.wait(lock, [this] { return !fFilled.empty() || fProducerDone; });
+	if(fFilled.empty()) {
+		if(fError) std::rethrow_exception(std::exchange(fError, nullptr));
+		return nullptr;
+	}
+	fCurrent = fFilled.front();
+	fFilled.pop_front();
+	return &fBuffers[fCurrent];
+}
@@ -0,0 +1,74 @@
+#include "Residual.h"
+#include "DisplayGraph.h"
+#include <TH1.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Small enough to stay in L1, large enough to amortise the per-block merge
+	constexpr size_t BLOCK = 512;
+	// Independent partial sums so the reductions vectorise without -ffast-math
+	constexpr size_t LANES = 4;
+}
+
+ResidualStats LinearResidual(const double* x, const double* y, size_t n, double p0, double p1, TH1* hist, DisplayGraph* graph)
+{
+	ResidualStats stats;
+	double m2 = 0;  // sum of squared deviations from stats.mean
+	double residual[BLOCK];
+	for(size_t first = 0; first < n; first += BLOCK) {
+		const size_t size = std::min(BLOCK, n - first);
+		const double* bx  = x + first;
+		const double* by  = y + first;
+		for(size_t i = 0; i < size; i++) {
+			residual[i] = p0 + p1*bx[i] - by[i];
+		}
+
+		// Mean and squared deviations of the block (two passes over L1), then Chan's merge
+		double sum[LANES] = {0};
+		double lo[LANES], hi[LANES];
+		std::fill(lo, lo + LANES, stats.min);
+		std::fill(hi, hi + LANES, stats.max);
+		size_t i = 0;
+		for(; i + LANES <= size; i += LANES) {
+			for(size_t lane = 0; lane < LANES; lane++) {
+				const double r = residual[i+lane];
+				sum[lane] += r;
+				lo[lane] = std::min(lo[lane], r);
+				hi[lane] = std::max(hi[lane], r);
+			}
+		}
+		for(; i < size; i++) {
+			sum[0] += residual[i];
+			lo[0] = std::min(lo[0], residual[i]);
+			hi[0] = std::max(hi[0], residual[i]);
+		}
+		const double block_mean = (sum[0] + sum[1] + sum[2] + sum[3]) / size;
+		stats.min = std::min({lo[0], lo[1], lo[2], lo[3]});
+		stats.max = std::max({hi[0], hi[1], hi[2], hi[3]});
+
+		double dev[LANES] = {0};
+		for(i = 0; i + LANES <= size; i += LANES) {
+			for(size_t lane = 0; lane < LANES; lane++) {
+				const double d = residual[i+lane] - block_mean;
+				dev[lane] += d*d;
+			}
+		}
+		for(; i < size; i++) {
+			const double d = residual[i] - block_mean;
+			dev[0] += d*d;
+		}
+		const double block_m2 = dev[0] + dev[1] + dev[2] + dev[3];
+
+		const double na = stats.n, nb = size, total = na + nb;
+		const double delta = block_mean - stats.mean;
+		m2         += block_m2 + delta*delta*na*nb/total;
+		stats.mean += delta*nb/total;
+		stats.n    += size;
+
+		if(hist != nullptr) hist->FillN(size, residual, nullptr);
+		if(graph != nullptr) graph->AddPoints(bx, residual, size);
+	}
+	stats.rms = (stats.n > 0) ? std::sqrt(m2 / stats.n) : 0;
+	return stats;
+}
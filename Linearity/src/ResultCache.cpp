@@ -0,0 +1,125 @@
+#include "ResultCache.h"
+#include <ROOT/RNTuple.hxx>
+#include <TFile.h>
+#include <unistd.h>
+#include <atomic>
+#include <filesystem>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+// 64-bit FNV-1a
+static std::uint64_t Hash(const void* data, size_t n, std::uint64_t hash = 14695981039346656037ULL)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for(size_t i = 0; i < n; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+template<typename T>
+static std::uint64_t HashValue(const T &value, std::uint64_t hash)
+{
+	return Hash(&value, sizeof(value), hash);
+}
+
+SourceIdentity SourceIdentity::Of(const std::string &file_name, const char* ntuple_name)
+{
+	SourceIdentity identity;
+	std::error_code ec;
+	const auto size  = std::filesystem::file_size(file_name, ec);
+	if(ec) return identity;
+	const auto mtime = std::filesystem::last_write_time(file_name, ec);
+	if(ec) return identity;
+
+	std::unique_ptr<TFile> file(TFile::Open(file_name.c_str(), "READ"));
+	if(!file || file->IsZombie()) return identity;
+	std::unique_ptr<ROOT::RNTuple> anchor(file->Get<ROOT::RNTuple>(ntuple_name));
+	if(!anchor) return identity;
+
+	std::uint64_t hash = Hash(nullptr, 0);
+	hash = HashValue(anchor->GetSeekHeader(),   hash);
+	hash = HashValue(anchor->GetNBytesHeader(), hash);
+	hash = HashValue(anchor->GetLenHeader(),    hash);
+	hash = HashValue(anchor->GetSeekFooter(),   hash);
+	hash = HashValue(anchor->GetNBytesFooter(), hash);
+	hash = HashValue(anchor->GetLenFooter(),    hash);
+
+	identity.size        = size;
+	identity.mtime       = mtime.time_since_epoch().count();
+	identity.anchor_hash = hash;
+	return identity;
+}
+
+ResultCache::ResultCache(std::string directory)
+	: fDirectory(std::move(directory))
+{
+	if(!Enabled()) return;
+	std::error_code ec;
+	std::filesystem::create_directories(fDirectory, ec);
+}
+
+std::string ResultCache::Key(const SourceIdentity &source, int soft_chan, int adc_chan, const std::string &config) const
+{
+	// Every unreadable source would share the same key
+	if(source.size == 0 && source.anchor_hash == 0) return "";
+	std::uint64_t hash = Hash(config.data(), config.size());
+	hash = HashValue(source.size,        hash);
+	hash = HashValue(source.mtime,       hash);
+	hash = HashValue(source.anchor_hash, hash);
+	hash = HashValue(soft_chan,          hash);
+	hash = HashValue(adc_chan,           hash);
+	std::ostringstream key;
+	key << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return key.str();
+}
+
+std::optional<CachedChannel> ResultCache::Load(const std::string &key) const
+{
+	if(!Enabled() || key.empty()) return std::nullopt;
+	const std::string file_name = fDirectory + "/" + key + ".root";
+	std::error_code ec;
+	if(!std::filesystem::exists(file_name, ec)) {
+		fMisses++;
+		return std::nullopt;
+	}
+	try {
+		CachedChannel channel;
+		channel.records = ReadFitRecords(file_name);
+		channel.states  = ReadChannelStates(file_name);
+		fHits++;
+		return channel;
+	}
+	catch(const std::exception&) {
+		// Unreadable entry, e.g. from an interrupted job: recompute and overwrite
+		fMisses++;
+		return std::nullopt;
+	}
+}
+
+bool ResultCache::Store(const std::string &key, const CachedChannel &channel) const
+{
+	if(!Enabled() || key.empty()) return false;
+	const std::string file_name = fDirectory + "/" + key + ".root";
+	// Written next to the entry and renamed, so concurrent jobs never read half an entry.
+	// The name is unique per process and call, so jobs storing the same key do not share it.
+	static std::atomic<unsigned> stored{0};
+	const std::string partial = file_name + ".partial." + std::to_string(getpid()) + "." + std::to_string(stored++);
+	try {
+		ResultsWriter out(partial);
+		for( auto const &record : channel.records ) out.Fill(record);
+		for( auto const &state : channel.states ) out.Fill(state);
+	}
+	catch(const std::exception&) {
+		std::error_code ec;
+		std::filesystem::remove(partial, ec);
+		return false;
+	}
+	std::error_code ec;
+	std::filesystem::rename(partial, file_name, ec);
+	if(!ec) return true;
+	std::filesystem::remove(partial, ec);
+	return false;
+}
@@ -0,0 +1,59 @@
+#include "ResultsWriter.h"
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleReader.hxx>
+#include <TFile.h>
+#include <stdexcept>
+
+ResultsWriter::ResultsWriter(const std::string &file_name)
+	: fFile(TFile::Open(file_name.c_str(), "RECREATE"))
+{
+	if(!fFile || fFile->IsZombie()) throw std::runtime_error("ResultsWriter: can not create " + file_name);
+	auto model = ROOT::RNTupleModel::Create();
+	fRecord    = model->MakeField<FitRecord>(FIELD_NAME);
+	fWriter    = ROOT::RNTupleWriter::Append(std::move(model), NTUPLE_NAME, *fFile);
+
+	auto state_model = ROOT::RNTupleModel::Create();
+	fState           = state_model->MakeField<ChannelState>(STATE_FIELD_NAME);
+	fStateWriter     = ROOT::RNTupleWriter::Append(std::move(state_model), STATE_NTUPLE_NAME, *fFile);
+}
+
+ResultsWriter::~ResultsWriter()
+{
+	fWriter.reset();
+	fStateWriter.reset();
+	fFile->Close();
+}
+
+void ResultsWriter::Fill(const FitRecord &record)
+{
+	*fRecord = record;
+	fWriter->Fill();
+}
+
+void ResultsWriter::Fill(const ChannelState &state)
+{
+	*fState = state;
+	fStateWriter->Fill();
+}
+
+std::vector<FitRecord> ReadFitRecords(const std::string &file_name)
+{
+	auto Reader = ROOT::RNTupleReader::Open(ResultsWriter::NTUPLE_NAME, file_name);
+	auto fit    = Reader->GetView<FitRecord>(ResultsWriter::FIELD_NAME);
+	std::vector<FitRecord> records;
+	for( auto entry : Reader->GetEntryRange() ) records.push_back(fit(entry));
+	return records;
+}
+
+std::vector<ChannelState> ReadChannelStates(const std::string &file_name)
+{
+	std::unique_ptr<TFile> file(TFile::Open(file_name.c_str(), "READ"));
+	if(!file || file->IsZombie()) throw std::runtime_error("ReadChannelStates: can not open " + file_name);
+	std::vector<ChannelState> states;
+	if(file->GetKey(ResultsWriter::STATE_NTUPLE_NAME) == nullptr) return states;
+
+	auto Reader = ROOT::RNTupleReader::Open(ResultsWriter::STATE_NTUPLE_NAME, file_name);
+	auto state  = Reader->GetView<ChannelState>(ResultsWriter::STATE_FIELD_NAME);
+	for( auto entry : Reader->GetEntryRange() ) states.push_back(state(entry));
+	return states;
+}
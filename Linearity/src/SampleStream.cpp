@@ -0,0 +1,93 @@
+#include "SampleStream.h"
+#include <stdexcept>
+
+static const char* FIELD_NAME = "SampleStream";
+
+static std::string SubField(const char* member)
+{
+	return std::string(FIELD_NAME) + "." + member;
+}
+
+SampleStreamView::SampleStreamView(ROOT::RNTupleReader* Reader, unsigned columns)
+	: fColumns(columns)
+{
+	if(Has(GATE1)) fGate1.emplace( Reader->GetView<gate_vector_t>(SubField("gate1")) );
+	if(Has(TSTMP)) fTimeStamp.emplace( Reader->GetView<tStmp_vector_t>(SubField("tStmp")) );
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+		if(Has(ChannelColumn(chan))) {
+			fChannel[chan].emplace( Reader->GetView<data_vector_t>(SubField(CHANNEL_MEMBER_NAMES[chan])) );
+		}
+	}
+}
+
+const gate_vector_t& SampleStreamView::gate1(ROOT::NTupleSize_t entry)
+{
+	if(!fGate1) throw std::logic_error("SampleStreamView: gate1 was not projected");
+	return (*fGate1)(entry);
+}
+
+const tStmp_vector_t& SampleStreamView::tStmp(ROOT::NTupleSize_t entry)
+{
+	if(!fTimeStamp) throw std::logic_error("SampleStreamView: tStmp was not projected");
+	return (*fTimeStamp)(entry);
+}
+
+const data_vector_t& SampleStreamView::ch_data(ROOT::NTupleSize_t entry, unsigned chan)
+{
+	if(chan >= N_SOFT_CHAN || !fChannel[chan]) throw std::logic_error("SampleStreamView: channel was not projected");
+	return (*fChannel[chan])(entry);
+}
+
+ChannelSet SampleStreamView::channels(ROOT::NTupleSize_t entry)
+{
+	ChannelSet channels;
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+		channels[chan] = fChannel[chan] ? &(*fChannel[chan])(entry) : nullptr;
+	}
+	return channels;
+}
+
+EntrySpans SampleStreamView::spans(ROOT::NTupleSize_t entry)
+{
+	EntrySpans spans;
+	if(fGate1)     spans.gate1 = (*fGate1)(entry);
+	if(fTimeStamp) spans.tStmp = (*fTimeStamp)(entry);
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+		if(fChannel[chan]) spans.ch_data[chan] = (*fChannel[chan])(entry);
+	}
+	return spans;
+}
+
+EntrySpans SampleStreamView::ReadInto(ROOT::NTupleSize_t entry, gate_vector_t &gate1, tStmp_vector_t &tStmp, PerChannel<data_vector_t> &ch_data)
+{
+	if(fGate1)     fGate1->BindRawPtr(&gate1);
+	if(fTimeStamp) fTimeStamp->BindRawPtr(&tStmp);
+	for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+		if(fChannel[chan]) fChannel[chan]->BindRawPtr(&ch_data[chan]);
+	}
+	return spans(entry);
+}
+
+ROOT::RNTupleGlobalRange SeekTimeRange(ROOT::RNTupleReader* Reader, double tmin, double tmax)
+{
+	SampleStreamView data(Reader, TSTMP);
+	const auto range = Reader->GetEntryRange();
+
+	// First entry ending at or after tmin
+	ROOT::NTupleSize_t lo = *range.begin(), hi = *range.end();
+	while(lo < hi) {
+		const auto mid = lo + (hi - lo) / 2;
+		if(data.tStmp(mid).back() < tmin) lo = mid + 1;
+		else                              hi = mid;
+	}
+	const ROOT::NTupleSize_t first = lo;
+
+	// First entry starting after tmax
+	hi = *range.end();
+	while(lo < hi) {
+		const auto mid = lo + (hi - lo) / 2;
+		if(data.tStmp(mid).front() <= tmax) lo = mid + 1;
+		else                                hi = mid;
+	}
+	return ROOT::RNTupleGlobalRange(first, lo);
+}
@@ -0,0 +1,178 @@
+#include "Spectrum.h"
+#include <TH1D.h>
+#include <TMath.h>
+#include <TVirtualFFT.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+// FFTW planning is not thread safe, executing a plan is
+static std::mutex gPlanMutex;
+
+WelchSpectrum::WelchSpectrum(size_t segment_length, double overlap, SPECTRUM_WINDOW window)
+	: fLength(segment_length), fWindowType(window)
+{
+	if(fLength < 16 || fLength % 2) throw std::invalid_argument("WelchSpectrum: segment length has to be even and at least 16");
+	if(overlap < 0 || overlap >= 1) throw std::invalid_argument("WelchSpectrum: overlap has to be in [0, 1)");
+	fHop = std::max<size_t>(1, std::lround(fLength*(1 - overlap)));
+
+	// Periodic windows, so a tone on a bin stays on its bin
+	fWindow.resize(fLength);
+	for(size_t i = 0; i < fLength; i++) {
+		const double phase = 2*TMath::Pi()*i/fLength;
+		switch(fWindowType) {
+			case SPECTRUM_WINDOW::HANN:
+				fWindow[i] = 0.5 - 0.5*std::cos(phase);
+				break;
+			case SPECTRUM_WINDOW::BLACKMAN_HARRIS:
+				fWindow[i] = 0.35875 - 0.48829*std::cos(phase) + 0.14128*std::cos(2*phase) - 0.01168*std::cos(3*phase);
+				break;
+		}
+		fWindowPower += fWindow[i]*fWindow[i];
+	}
+	fSegment.resize(fLength);
+	fWindowed.resize(fLength);
+	fPower.assign(fLength/2 + 1, 0);
+}
+
+WelchSpectrum::~WelchSpectrum() = default;
+WelchSpectrum::WelchSpectrum(WelchSpectrum&&) = default;
+WelchSpectrum& WelchSpectrum::operator=(WelchSpectrum&&) = default;
+
+unsigned WelchSpectrum::LobeBins() const
+{
+	return (fWindowType == SPECTRUM_WINDOW::HANN) ? 3 : 5;
+}
+
+void WelchSpectrum::Add(const double* samples, size_t n)
+{
+	while(n > 0) {
+		const size_t take = std::min(n, fLength - fFilled);
+		std::copy(samples, samples + take, fSegment.begin() + fFilled);
+		fFilled += take;
+		samples += take;
+		n       -= take;
+		if(fFilled == fLength) {
+			Transform();
+			// The next segment starts fHop samples later
+			std::copy(fSegment.begin() + fHop, fSegment.end(), fSegment.begin());
+			fFilled = fLength - fHop;
+		}
+	}
+}
+
+void WelchSpectrum::Transform()
+{
+	if(!fFFT) {
+		std::lock_guard<std::mutex> lock(gPlanMutex);
+		int n = fLength;
+		fFFT.reset( TVirtualFFT::FFT(1, &n, "R2C ES K") );
+		if(!fFFT) throw std::runtime_error("WelchSpectrum: no FFT backend (ROOT built without fftw3?)");
+	}
+	for(size_t i = 0; i < fLength; i++) fWindowed[i] = fSegment[i]*fWindow[i];
+	fFFT->SetPoints(fWindowed.data());
+	fFFT->Transform();
+	for(size_t k = 0; k < fPower.size(); k++) {
+		double re, im;
+		fFFT->GetPointComplex(k, re, im);
+		fPower[k] += re*re + im*im;
+	}
+	fSegments++;
+}
+
+void WelchSpectrum::Merge(const WelchSpectrum &other)
+{
+	if(other.fLength != fLength || other.fWindowType != fWindowType) {
+		throw std::invalid_argument("WelchSpectrum: can not merge spectra of different segments");
+	}
+	for(size_t k = 0; k < fPower.size(); k++) fPower[k] += other.fPower[k];
+	fSegments += other.fSegments;
+}
+
+std::vector<double> WelchSpectrum::PSD(double sample_rate) const
+{
+	std::vector<double> psd(fPower.size(), 0);
+	if(fSegments == 0) return psd;
+	const double scale = 1/(sample_rate*fWindowPower*fSegments);
+	for(size_t k = 0; k < psd.size(); k++) {
+		// DC and Nyquist have no negative frequency partner
+		const double fold = (k == 0 || k == psd.size() - 1) ? 1 : 2;
+		psd[k] = fold*scale*fPower[k];
+	}
+	return psd;
+}
+
+SpectrumMetrics WelchSpectrum::Analyze(double sample_rate, unsigned harmonics) const
+{
+	SpectrumMetrics metrics;
+	const std::vector<double> psd = PSD(sample_rate);
+	const long   last = psd.size() - 1;
+	const long   lobe = LobeBins();
+	const double df   = sample_rate/fLength;
+	if(fSegments == 0 || last <= 2*lobe) return metrics;
+
+	// Bins already charged to DC, the fundamental or a harmonic
+	std::vector<bool> used(psd.size(), false);
+	auto Claim = [&](long center) {
+		double power = 0;
+		for(long k = std::max(0L, center - lobe); k <= std::min(last, center + lobe); k++) {
+			if(used[k]) continue;
+			used[k] = true;
+			power  += psd[k]*df;
+		}
+		return power;
+	};
+	Claim(0);
+
+	// Fundamental: highest bin above DC, frequency from the centroid of its lobe
+	const long peak = std::max_element(psd.begin() + lobe + 1, psd.end()) - psd.begin();
+	double sum = 0, sum_k = 0;
+	for(long k = std::max(0L, peak - lobe); k <= std::min(last, peak + lobe); k++) {
+		sum   += psd[k];
+		sum_k += psd[k]*k;
+	}
+	metrics.frequency = (sum > 0 ? sum_k/sum : peak)*df;
+	metrics.signal    = Claim(peak);
+
+	// Harmonics, folded back into [0, fs/2]
+	for(unsigned h = 2; h <= harmonics; h++) {
+		double f = std::fmod(h*metrics.frequency, sample_rate);
+		if(f > sample_rate/2) f = sample_rate - f;
+		metrics.distortion += Claim(std::lround(f/df));
+	}
+
+	// Noise over the free bins, extrapolated to the bins of the tones;
+	// the largest spur is the highest bin outside of DC and the fundamental lobe
+	double noise = 0, spur = 0;
+	long free_bins = 0;
+	for(long k = 0; k <= last; k++) {
+		if(std::abs(k - peak) > lobe && k > lobe) spur = std::max(spur, psd[k]);
+		if(used[k]) continue;
+		noise += psd[k]*df;
+		free_bins++;
+	}
+	if(free_bins > 0) noise *= double(last - lobe)/free_bins;
+	metrics.noise = noise;
+
+	metrics.noise_density = std::sqrt(noise/(sample_rate/2));
+	auto dB = [](double ratio) { return (ratio > 0) ? 10*std::log10(ratio) : -std::numeric_limits<double>::infinity(); };
+	metrics.snr   = dB(metrics.signal/noise);
+	metrics.sinad = dB(metrics.signal/(noise + metrics.distortion));
+	metrics.thd   = dB(metrics.distortion/metrics.signal);
+	metrics.sfdr  = dB(psd[peak]/spur);
+	metrics.enob  = (metrics.sinad - 1.76)/6.02;
+	return metrics;
+}
+
+std::unique_ptr<TH1D> WelchSpectrum::ToTH1(const char* name, const char* title, double sample_rate) const
+{
+	const std::vector<double> psd = PSD(sample_rate);
+	const double df = sample_rate/fLength;
+	// Bins centred on the FFT frequencies
+	auto hist = std::make_unique<TH1D>(name, title, psd.size(), -df/2, (psd.size() - 0.5)*df);
+	hist->SetDirectory(nullptr);
+	for(size_t k = 0; k < psd.size(); k++) hist->SetBinContent(k + 1, std::sqrt(psd[k]));
+	return hist;
+}
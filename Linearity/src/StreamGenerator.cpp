@@ -0,0 +1,89 @@
+#include "StreamGenerator.h"
+#include "SampleStream.h"
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+#include <TMath.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+StreamGenerator::StreamGenerator(const GeneratorConfig &config)
+	: fConfig(config),
+	  fLSB(config.voltage_ref / std::ldexp(1.0, config.adc_bits)),
+	  fRng(config.seed),
+	  fNoise(0, config.noise_rms)
+{
+	if(fConfig.dnl_rms > 0) {
+		// Random code widths 1+d, rescaled so the full scale stays put
+		const long n_codes = 1L << fConfig.adc_bits;
+		std::normal_distribution<double> width(1.0, fConfig.dnl_rms);
+		std::vector<double> widths(n_codes);
+		for(auto &w : widths) w = std::max(0.0, width(fRng));
+		const double scale = n_codes / std::accumulate(std::begin(widths), std::end(widths), 0.0);
+		fTransitions.resize(n_codes);
+		double level = -n_codes/2 - 0.5;
+		for(long code = 0; code < n_codes; code++) {
+			level += widths[code] * scale;
+			fTransitions[code] = level;
+		}
+	}
+}
+
+double StreamGenerator::Analog(std::uint64_t sample, double polarity) const
+{
+	const unsigned period = fConfig.gate_on + fConfig.gate_off;
+	const unsigned phase  = sample % period;
+	switch(fConfig.shape) {
+		case SIGNAL_SHAPE::RAMP:
+			if(phase >= fConfig.gate_on) return fConfig.offset;
+			return fConfig.offset + polarity * fConfig.amplitude * (2.0*phase/std::max(1u, fConfig.gate_on-1) - 1.0);
+		case SIGNAL_SHAPE::SINE:
+			return fConfig.offset + polarity * fConfig.amplitude * std::sin(2*TMath::Pi()*sample/fConfig.sine_period);
+		case SIGNAL_SHAPE::BASELINE:
+			break;
+	}
+	return fConfig.offset;
+}
+
+double StreamGenerator::Quantize(double volts) const
+{
+	const long   half = 1L << (fConfig.adc_bits-1);
+	const double code = volts / fLSB;
+	long quantized;
+	if(fTransitions.empty()) {
+		quantized = std::lround(code);
+	} else {
+		quantized = std::distance(std::begin(fTransitions), std::upper_bound(std::begin(fTransitions), std::end(fTransitions), code)) - half;
+	}
+	return std::clamp(quantized, -half, half - 1) * fLSB;
+}
+
+bool StreamGenerator::Next(tDataSamples &entry)
+{
+	const std::uint64_t n = std::min<std::uint64_t>(fConfig.samples_per_entry, fConfig.samples - fSample);
+	entry.gate1.resize(n);
+	entry.tStmp.resize(n);
+	for( auto member : CHANNEL_MEMBERS ) (entry.*member).resize(n);
+	const unsigned period = fConfig.gate_on + fConfig.gate_off;
+	for(std::uint64_t index = 0; index < n; index++, fSample++) {
+		entry.gate1[index]    = (fSample % period) < fConfig.gate_on;
+		entry.tStmp[index]    = (fSample + 1) * fConfig.tstmp_step;
+		// Odd channels see the signal with the opposite polarity
+		for(unsigned chan = 0; chan < N_SOFT_CHAN; chan++) {
+			(entry.*CHANNEL_MEMBERS[chan])[index] = Quantize( Analog(fSample, (chan % 2) ? -1.0 : +1.0) + fNoise(fRng) );
+		}
+	}
+	return n > 0;
+}
+
+void WriteSampleStream(const GeneratorConfig &config, const std::string &file_name)
+{
+	auto model  = ROOT::RNTupleModel::Create();
+	auto sample = model->MakeField<tDataSamples>("SampleStream");
+	auto writer = ROOT::RNTupleWriter::Recreate(std::move(model), "DataTree", file_name);
+
+	StreamGenerator generator(config);
+	while(generator.Next(*sample)) {
+		writer->Fill();
+	}
+}
@@ -0,0 +1,83 @@
+// ChannelState of a run merged from shards against the state of one unsharded pass
+#include "ChannelState.h"
+#include "CodeHistogram.h"
+#include "LinearFit.h"
+#include "AdcSpec.h"
+#include "Check.h"
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using ADC = ADC_18BIT;
+
+// State of the samples [first, last), as Macro/linearity fill it, plus exact moments
+static ChannelState State(const std::vector<double> &t, const std::vector<double> &v, size_t first, size_t last, std::int32_t run)
+{
+	LinearFit fit;
+	auto codes = CodeHistogram::For<ADC>();
+	ChannelState state;
+	state.adc_chan = 3;
+	state.run      = run;
+	state.files    = {"run" + std::to_string(run) + ".root"};
+	for(size_t i = first; i < last; i++) {
+		fit.Add(t[i], v[i]);
+		codes.Fill(ADC::ToCode(v[i]));
+		const double delta = v[i] - state.mean;
+		state.n++;
+		state.mean += delta/state.n;
+		state.m2   += delta*(v[i] - state.mean);
+		if(v[i] < state.min) { state.min = v[i]; state.min_tstmp = t[i]; }
+		if(v[i] > state.max) { state.max = v[i]; state.max_tstmp = t[i]; }
+	}
+	state.SetFit(fit);
+	state.SetCodes(codes, ADC::LSB);
+	return state;
+}
+
+int main()
+{
+	std::mt19937_64 rng(11);
+	std::normal_distribution<double> noise(0, 2e-4);
+	std::vector<double> t, v;
+	for(size_t i = 0; i < 60000; i++) {
+		t.push_back(1e6 + i);
+		v.push_back(-0.5 + 1.0*i/60000 + noise(rng));
+	}
+
+	const ChannelState single = State(t, v, 0, t.size(), 0);
+	ChannelState merged = State(t, v, 40000, 60000, 2);
+	merged.Merge(State(t, v, 0, 10000, 0));
+	merged.Merge(State(t, v, 10000, 40000, 1));
+
+	Check(merged.run == 0, "run is the lowest merged in");
+	Check(merged.files.size() == 3, "files of every shard");
+	Check(merged.n == single.n, "sample count");
+	CheckClose(merged.mean, single.mean, 1e-9, "mean", 1e-12);
+	CheckClose(merged.m2,   single.m2,   1e-9, "m2");
+	Check(merged.min == single.min && merged.min_tstmp == single.min_tstmp, "minimum");
+	Check(merged.max == single.max && merged.max_tstmp == single.max_tstmp, "maximum");
+
+	const LinearFit fit_merged = merged.Fit(), fit_single = single.Fit();
+	Check(fit_merged.N() == fit_single.N(), "fit N");
+	CheckClose(fit_merged.Slope(),     fit_single.Slope(),     1e-9, "fit slope");
+	CheckClose(fit_merged.Intercept(), fit_single.Intercept(), 1e-9, "fit intercept");
+
+	Check(merged.first_code == single.first_code, "first code");
+	Check(merged.counts == single.counts, "code counts");
+	Check(merged.underflow == single.underflow && merged.overflow == single.overflow, "under-/overflow");
+	const CodeLinearity dnl_merged = merged.Codes().RampLinearity(), dnl_single = single.Codes().RampLinearity();
+	CheckClose(dnl_merged.MaxAbsDNL(), dnl_single.MaxAbsDNL(), 1e-12, "max |DNL|");
+
+	// States of other or unknown channels are never combined
+	ChannelState other = single;
+	other.adc_chan = 4;
+	bool threw = false;
+	try { ChannelState copy = single; copy.Merge(other); } catch(const std::invalid_argument&) { threw = true; }
+	Check(threw, "merge of different ADC channels throws");
+	other.adc_chan = -1;
+	threw = false;
+	try { ChannelState copy = other; copy.Merge(other); } catch(const std::invalid_argument&) { threw = true; }
+	Check(threw, "merge of an unknown ADC channel throws");
+	return Failures();
+}
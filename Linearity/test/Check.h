@@ -0,0 +1,31 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Minimal assertions for the test programs: each failed check is printed,
+// and Failures() is the exit code of main (make test stops on the first nonzero one).
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+inline int& Failures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+inline void Check(bool ok, const std::string &what)
+{
+	if(ok) return;
+	std::cerr << "FAILED: " << what << "\n";
+	Failures()++;
+}
+
+// |a - b| within rel of the larger magnitude (or abs near 0)
+inline void CheckClose(double a, double b, double rel, const std::string &what, double abs = 0)
+{
+	const bool ok = std::abs(a - b) <= std::max(abs, rel*std::max(std::abs(a), std::abs(b)));
+	Check(ok, what + ": " + std::to_string(a) + " vs " + std::to_string(b));
+}
+
+#endif
@@ -0,0 +1,114 @@
+// FindMinMax of every kernel the CPU supports against a plain loop, on the
+// inputs the vector paths handle differently: spans shorter than a vector,
+// every tail length, repeated extreme values (the first index has to win),
+// all-negative samples, and UpdateExtremaGated over gate1 masks.
+#include "Extrema.h"
+#include "Check.h"
+#include <random>
+#include <string>
+#include <vector>
+
+// First occurrence of min and max, without any assumption on the sign of the samples
+static MinMaxIndex Reference(const double* data, size_t n)
+{
+	MinMaxIndex r;
+	for(size_t index = 0; index < n; index++) {
+		if(r.min_index == MinMaxIndex::NPOS || data[index] < r.min) { r.min = data[index]; r.min_index = index; }
+		if(r.max_index == MinMaxIndex::NPOS || data[index] > r.max) { r.max = data[index]; r.max_index = index; }
+	}
+	return r;
+}
+
+static bool Same(const MinMaxIndex &a, const MinMaxIndex &b)
+{
+	return a.min == b.min && a.min_index == b.min_index && a.max == b.max && a.max_index == b.max_index;
+}
+
+static const EXTREMA_KERNEL KERNELS[] = {EXTREMA_KERNEL::SCALAR, EXTREMA_KERNEL::AVX2, EXTREMA_KERNEL::AVX512, EXTREMA_KERNEL::AUTO};
+
+static void CheckKernels(const std::vector<double> &data, const std::string &what)
+{
+	const MinMaxIndex reference = Reference(data.data(), data.size());
+	for( auto kernel : KERNELS ) {
+		if(!ExtremaKernelSupported(kernel)) continue;
+		const MinMaxIndex r = FindMinMax(data.data(), data.size(), kernel);
+		Check(Same(r, reference), std::string(ExtremaKernelName(kernel)) + ", " + what + ": min " + std::to_string(r.min) + " at " + std::to_string(r.min_index)
+		                          + ", max " + std::to_string(r.max) + " at " + std::to_string(r.max_index));
+	}
+}
+
+int main()
+{
+	for( auto kernel : KERNELS ) {
+		if(!ExtremaKernelSupported(kernel)) std::cout << ExtremaKernelName(kernel) << " not supported by this CPU, not tested\n";
+	}
+	std::mt19937_64 rng(5);
+	std::uniform_real_distribution<double> uniform(-2, 2);
+
+	// Nothing to find
+	for( auto kernel : KERNELS ) {
+		if(ExtremaKernelSupported(kernel)) Check(FindMinMax(nullptr, 0, kernel).Empty(), std::string(ExtremaKernelName(kernel)) + ": empty span");
+	}
+
+	// Below, at and past the lane widths (4, 8): every tail length of both vector paths
+	for(size_t n = 1; n <= 40; n++) {
+		std::vector<double> data(n);
+		for( auto &d : data ) d = uniform(rng);
+		CheckKernels(data, "n = " + std::to_string(n));
+		// Extremes in the tail only
+		data[n-1] = 3;
+		if(n > 1) data[n-2] = -3;
+		CheckKernels(data, "extremes in the tail, n = " + std::to_string(n));
+	}
+
+	// All negative: a maximum started at 0 (or DBL_MIN) would never move
+	for( size_t n : {3, 7, 8, 13, 1000} ) {
+		std::vector<double> data(n);
+		for( auto &d : data ) d = -1 - std::abs(uniform(rng));
+		CheckKernels(data, "all negative, n = " + std::to_string(n));
+	}
+
+	// Ties: the same min and max in several lanes and in the tail, first index wins
+	for( size_t n : {5, 9, 16, 37, 1001} ) {
+		std::vector<double> data(n, 0.5);
+		CheckKernels(data, "constant, n = " + std::to_string(n));
+		for(size_t index = 1; index < n; index += 3) data[index] = -1;
+		for(size_t index = 2; index < n; index += 5) data[index] =  1;
+		CheckKernels(data, "repeated extremes, n = " + std::to_string(n));
+	}
+
+	// Large spans, extremes in random places
+	for(unsigned trial = 0; trial < 20; trial++) {
+		std::vector<double> data(4096 + trial);
+		for( auto &d : data ) d = uniform(rng);
+		data[rng() % data.size()] = -5;
+		data[rng() % data.size()] =  5;
+		CheckKernels(data, "random span " + std::to_string(trial));
+	}
+
+	// UpdateExtremaGated against a loop over the gated samples
+	std::bernoulli_distribution open(0.7);
+	for( unsigned mask : {0u, 1u, 2u, 3u} ) {
+		const size_t n = 203;
+		std::vector<double>   data(n);
+		std::vector<unsigned> gate1(n), tStmp(n);
+		for(size_t index = 0; index < n; index++) {
+			data[index]  = -1 - std::abs(uniform(rng));
+			tStmp[index] = 100 + index;
+			// 0: closed, 1: open, 2: random runs, 3: alternating
+			gate1[index] = (mask == 0) ? 0 : (mask == 1) ? 1 : (mask == 2) ? unsigned(open(rng)) : unsigned(index % 2);
+		}
+		ChannelExtrema gated;
+		UpdateExtremaGated(gated, data.data(), gate1.data(), tStmp.data(), n);
+		ChannelExtrema expected;
+		for(size_t index = 0; index < n; index++) {
+			if(gate1[index] == 0) continue;
+			if(data[index] > expected.max) { expected.max = data[index]; expected.MaxTimeStamp = tStmp[index]; }
+			if(data[index] < expected.min) { expected.min = data[index]; expected.MinTimeStamp = tStmp[index]; }
+		}
+		const std::string what = "gated mask " + std::to_string(mask);
+		Check(gated.max == expected.max && gated.MaxTimeStamp == expected.MaxTimeStamp, what + ": max");
+		Check(gated.min == expected.min && gated.MinTimeStamp == expected.MinTimeStamp, what + ": min");
+	}
+	return Failures();
+}
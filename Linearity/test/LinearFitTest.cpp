@@ -0,0 +1,34 @@
+// LinearFit merged from shards against one pass over the same points,
+// with the large tStmp offset of a real run.
+#include "LinearFit.h"
+#include "Check.h"
+#include <random>
+#include <vector>
+
+int main()
+{
+	std::mt19937_64 rng(7);
+	std::normal_distribution<double> noise(0, 1e-3);
+	const double t0 = 4.2e9, slope = 3.7e-5, intercept = -0.049;
+
+	LinearFit single;
+	std::vector<LinearFit> shards(5);
+	for(size_t i = 0; i < 100000; i++) {
+		const double t = t0 + i;
+		const double v = intercept + slope*(t - t0) + noise(rng);
+		single.Add(t, v);
+		// Uneven shards, one of them empty
+		shards[(i*i) % 4].Add(t, v);
+	}
+	LinearFit merged;
+	for( auto const &shard : shards ) merged.Merge(shard);
+
+	Check(merged.N() == single.N(), "merged N");
+	CheckClose(merged.Slope(),          single.Slope(),          1e-9, "slope");
+	CheckClose(merged.Intercept(),      single.Intercept(),      1e-9, "intercept");
+	CheckClose(merged.SlopeError(),     single.SlopeError(),     1e-6, "slope error");
+	CheckClose(merged.InterceptError(), single.InterceptError(), 1e-6, "intercept error");
+	CheckClose(merged.Chi2(),           single.Chi2(),           1e-6, "chi2");
+	CheckClose(single.Slope(), slope, 1e-3, "slope against the truth");
+	return Failures();
+}
@@ -0,0 +1,40 @@
+// RampScanner and FitScannedCycle on a generated ramp: every full cycle is
+// found, the first (partial) one is skipped, and the slopes are the generator's.
+#include "RampScanner.h"
+#include "CycleFit.h"
+#include "StreamGenerator.h"
+#include "Check.h"
+#include <vector>
+
+int main()
+{
+	GeneratorConfig config;
+	config.samples           = 10*(config.gate_on + config.gate_off) + 7000;
+	config.samples_per_entry = 4096;
+	// Slope per sample of the ramp, ch1 runs the other way
+	const double slope = 2*config.amplitude/(config.gate_on - 1)/config.tstmp_step;
+
+	StreamGenerator generator(config);
+	RampScanner scanner;
+	std::vector<CycleFit> fits;
+	tDataSamples entry;
+	while(generator.Next(entry)) {
+		// The entry that ends a cycle may already open the next one
+		while(!scanner.Process(entry)) {
+			for( auto const &fit : FitScannedCycle(scanner, 20) ) {
+				if(fit.n > 0) fits.push_back(fit);
+			}
+			scanner.NextCycle();
+		}
+	}
+
+	// Cycle 0 opens with the first sample and is skipped; cycles 1..9 close before the end, cycle 10 does not
+	Check(fits.size() == 9*N_SOFT_CHAN, "fits of every complete cycle after the first: " + std::to_string(fits.size()));
+	for( auto const &fit : fits ) {
+		const double expected = (fit.chan % 2) ? -slope : slope;
+		CheckClose(fit.slope, expected, 1e-4, "slope of ch" + std::to_string(fit.chan));
+		Check(fit.rms_residual < 1e-3, "residual RMS of ch" + std::to_string(fit.chan) + ": " + std::to_string(fit.rms_residual));
+		Check(fit.n > config.gate_on - 100 && fit.n < config.gate_on, "fit window of ch" + std::to_string(fit.chan) + ": " + std::to_string(fit.n));
+	}
+	return Failures();
+}
@@ -0,0 +1,37 @@
+// WelchSpectrum of a pure tone in white noise: frequency and SNR of the
+// fundamental against their analytic values, unchanged when the stream is
+// split into two spectra and merged.
+#include "Spectrum.h"
+#include "Check.h"
+#include <TMath.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+int main()
+{
+	const double sample_rate = 1e6, frequency = 12345.6, amplitude = 1.0, noise_rms = 1e-3;
+	std::mt19937_64 rng(3);
+	std::normal_distribution<double> noise(0, noise_rms);
+	std::vector<double> samples(16*4096);
+	for(size_t i = 0; i < samples.size(); i++) samples[i] = 0.01 + amplitude*std::sin(2*TMath::Pi()*frequency*i/sample_rate) + noise(rng);
+	// (A^2/2)/sigma^2
+	const double snr = 10*std::log10(amplitude*amplitude/2/(noise_rms*noise_rms));
+
+	WelchSpectrum spectrum(4096);
+	spectrum.Add(samples.data(), samples.size());
+	const SpectrumMetrics metrics = spectrum.Analyze(sample_rate);
+	CheckClose(metrics.frequency, frequency, 1e-3, "fundamental");
+	CheckClose(metrics.snr, snr, 0, "SNR [dB]", 0.5);
+	Check(metrics.sfdr > 50, "SFDR [dBc] of a pure tone: " + std::to_string(metrics.sfdr));
+
+	// Tasks split at a segment boundary (overlap 0.5: hop 2048)
+	WelchSpectrum first(4096), second(4096);
+	const size_t split = 8*4096;
+	first .Add(samples.data(), split);
+	second.Add(samples.data() + split - 2048, samples.size() - split + 2048);
+	first.Merge(second);
+	const SpectrumMetrics merged = first.Analyze(sample_rate);
+	CheckClose(merged.snr, metrics.snr, 0, "SNR of merged tasks [dB]", 0.2);
+	return Failures();
+}